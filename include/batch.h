@@ -0,0 +1,47 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstddef>
+#include <string>
+#include "lcp.h"
+#include "options.h"
+using std::string;
+
+/*
+ * Runs the construction on the input, with the engine of the options or
+ * the generalized one for FASTA/FASTQ inputs, and writes the LCP array (and
+ * the documents) in the format of the options. Results are 32-bit if the
+ * input is short enough, and 64-bit otherwise. Returns false and sets the
+ * error if an output can't be written.
+ */
+bool IndexAndWrite(const Text& input, const Options& options, const string& lcp_filename, const string& document_filename, string& error);
+
+/*
+ * Settings of the batch mode.
+ *  - threads: number of worker threads
+ *  - memory_budget: bytes that jobs running at the same time may use
+ *    together, by estimate; a job larger than the budget runs alone
+ *  - output_directory: where outputs are written, NULL for next to the
+ *    inputs
+ */
+struct BatchOptions {
+  int threads;
+  size_t memory_budget;
+  const char *output_directory;
+
+  BatchOptions();
+};
+
+/*
+ * Indexes many independent input files in parallel. The path is either a
+ * directory, whose regular files are all inputs, or a file listing one
+ * input path per line. Files are sorted largest first and dealt out round
+ * robin to the queues of a pool of threads, and a thread whose queue is
+ * empty takes from the front of the others. The outputs of each file are
+ * written as soon as it is done, to <name>.lcp.<extension> (and
+ * <name>.document.<extension> for FASTA/FASTQ inputs). Returns non-zero if
+ * any file failed.
+ */
+int RunBatch(const char *path, const Options& options, const BatchOptions& batch);
+
+#endif
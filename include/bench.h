@@ -0,0 +1,12 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+ * Runs the benchmark on the input(1,2,3...).txt files of the directory and
+ * on synthetic inputs. Prints per-phase times, throughput and peak RSS of
+ * every input, and writes them as JSON if json_filename is not NULL, tagged
+ * with the label (e.g. a commit id). Returns non-zero on failure.
+ */
+int Benchmark(const char *directory, const char *json_filename, const char *label);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef COMPARE_H
+#define COMPARE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/*
+ * Returns the length of the common prefix of a and b, looking at no more
+ * than 'length' characters of each. Compares 32 bytes at a time with AVX2
+ * or 16 with SSE2 where the compiler targets them, then 8 bytes at a time
+ * as words, and the rest byte by byte. Never reads past 'length'.
+ */
+inline size_t CommonPrefix(const char *a, const char *b, size_t length) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 32 <= length; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+    __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+    unsigned int equal = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+    if (equal != 0xffffffffu) {
+      return i + __builtin_ctz(~equal);
+    }
+  }
+#elif defined(__SSE2__)
+  for (; i + 16 <= length; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+    __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+    unsigned int equal = _mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+    if (equal != 0xffffu) {
+      return i + __builtin_ctz(~equal & 0xffffu);
+    }
+  }
+#endif
+  for (; i + 8 <= length; i += 8) {
+    uint64_t x, y;
+    memcpy(&x, a + i, 8);
+    memcpy(&y, b + i, 8);
+    if (x != y) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      return i + (__builtin_ctzll(x ^ y) >> 3);
+#else
+      return i + (__builtin_clzll(x ^ y) >> 3);
+#endif
+    }
+  }
+  while (i < length && a[i] == b[i]) {
+    i++;
+  }
+  return i;
+}
+
+#endif
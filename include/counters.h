@@ -0,0 +1,57 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <cstddef>
+
+/*
+ * Counts of operations on the hot paths of the construction, used to find
+ * out why an input is slow. Counting is compiled in only when
+ * COUNTERS_ENABLED is defined (make COUNTERS=1), otherwise COUNT expands to
+ * nothing. Every thread counts on its own.
+ */
+//#define COUNTERS_ENABLED
+
+struct OperationCounts {
+  long long lcp_chars;            // characters compared by Lcp(a, b, input)
+  long long name_chars;           // characters compared between names in step 3
+  long long min_lcp_scans;        // lcps popped from the stack by LcpMinima::Scan
+  long long border_updates;       // UpdateBorder calls
+  long long bucket_lookups;       // GetBucket calls
+
+  OperationCounts() {
+    lcp_chars = name_chars = min_lcp_scans = 0;
+    border_updates = bucket_lookups = 0;
+  }
+};
+
+#ifdef COUNTERS_ENABLED
+extern thread_local OperationCounts operation_counts;
+#define COUNT(counter, amount) (operation_counts.counter += (amount))
+#else
+#define COUNT(counter, amount) ((void)0)
+#endif
+
+/*
+ * Sets all counts of this thread to zero.
+ */
+void ResetOperationCounts();
+
+/*
+ * Returns the counts of this thread, NULL if counting is disabled.
+ */
+OperationCounts *ThreadOperationCounts();
+
+/*
+ * Adds the counts of this thread to the given counts of another thread,
+ * for helper threads that do part of that thread's work.
+ */
+void MergeOperationCounts(OperationCounts *into);
+
+/*
+ * Prints the counts of this thread, in total and per character of an input
+ * of the given length. Counts growing faster than the input point to the
+ * superlinear paths. Prints nothing if counting is disabled.
+ */
+void PrintOperationCounts(size_t length);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef ENGINES_H
+#define ENGINES_H
+
+#include "lcp.h"
+
+/*
+ * Ways of building the LCP array.
+ *  - kInducingEngine: the modified SA-IS of CalculateSuffixArrayLCP, which
+ *    induces the LCP values along with the suffix array
+ *  - kKasaiEngine: plain SA-IS, then Kasai's algorithm over the inverse
+ *    suffix array, in suffix array order of the text positions
+ *  - kPhiEngine: plain SA-IS, then the permuted LCP array computed in text
+ *    order through the Phi array, which replaces the inverse suffix array
+ *  - kAutoEngine: the default one of the above, from DefaultLcpEngine
+ */
+enum LcpEngine {
+  kAutoEngine,
+  kInducingEngine,
+  kKasaiEngine,
+  kPhiEngine
+};
+
+/*
+ * Parses the engine name (auto, inducing, kasai, phi), returns false for
+ * unknown names.
+ */
+bool ParseLcpEngine(const char *name, LcpEngine& engine);
+
+/*
+ * Returns the name of the engine.
+ */
+const char *LcpEngineName(LcpEngine engine);
+
+/*
+ * Returns the engine that auto stands for.
+ */
+LcpEngine DefaultLcpEngine();
+
+/*
+ * Calculates the suffix array and the LCP array of the input with the given
+ * engine. Both buffers have input.length() elements; the suffix array may
+ * be NULL. If times is given, time spent in each phase is added to it.
+ * The int overload throws if the input is longer than kMaxInt32Length.
+ */
+void CalculateSuffixArrayLCP(const Text& input, int* sa, int* lcp, LcpEngine engine, PhaseTimes* times = NULL);
+void CalculateSuffixArrayLCP(const Text& input, long long* sa, long long* lcp, LcpEngine engine, PhaseTimes* times = NULL);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef EXTERNAL_H
+#define EXTERNAL_H
+
+#include <cstddef>
+#include <string>
+#include "options.h"
+using std::string;
+
+/*
+ * I/O done by an external construction, in bytes.
+ *  - text_read: read sequentially by the scans of the input file
+ *  - temp_written, temp_read: the temporary files of the names, the
+ *    sorted runs and the LCP values, all written and read sequentially
+ *  - output_written: the suffix array and LCP files
+ */
+struct ExternalStats {
+  int scans;
+  int rounds;
+  int runs;
+  unsigned long long text_read;
+  unsigned long long temp_written;
+  unsigned long long temp_read;
+  unsigned long long output_written;
+
+  ExternalStats() {
+    scans = rounds = runs = 0;
+    text_read = temp_written = temp_read = output_written = 0;
+  }
+};
+
+/*
+ * Builds the suffix array and the LCP array of the input file within about
+ * 'memory_budget' bytes of RAM, whatever the size of the input, and streams
+ * both to the files in the format of the options. The text is the file up
+ * to the first whitespace, sentinel or NUL byte, followed by the sentinel,
+ * and its bytes compare as signed chars, as in the in-memory engines.
+ * Suffixes are sorted by prefix doubling, with external sorts that spill
+ * sorted runs to temporary files next to the LCP file and merge them back,
+ * and the LCP values are found from the names of the doubling rounds. All
+ * files are read and written sequentially. Returns false and sets the
+ * error if a file can't be read or written.
+ */
+bool ExternalSuffixArrayLCP(const char *filename, const Options& options, size_t memory_budget,
+    const string& sa_filename, const string& lcp_filename, ExternalStats& stats, string& error);
+
+/*
+ * Prints the I/O volume of an external construction.
+ */
+void PrintExternalStats(const ExternalStats& stats);
+
+#endif
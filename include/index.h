@@ -0,0 +1,148 @@
+#ifndef INDEX_H
+#define INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "engines.h"
+#include "input.h"
+using std::string;
+
+/*
+ * Format of index files, bumped whenever the layout changes. Loaders only
+ * take files of their own version.
+ */
+const uint32_t kIndexVersion = 2;
+
+/*
+ * Magic bytes at the start of index files, and the byte order marker.
+ */
+const char kIndexMagic[8] = {'L', 'C', 'P', 'I', 'N', 'D', 'E', 'X'};
+const uint32_t kIndexByteOrder = 0x01020304;
+
+/*
+ * Header at the start of an index file. Values are in the byte order of
+ * the machine that built it; byte_order holds kIndexByteOrder, so loaders
+ * on machines of the other byte order reject the file. Sections
+ * (the text with its sentinel, the suffix array, the LCP array and the
+ * bucket boundaries) start at 64-byte aligned offsets, so the mapped file
+ * is used in place. The suffix array and LCP array have index_bytes (4 or
+ * 8) per value. The checksums cover the text, the three other sections,
+ * and the header itself (with header_checksum as 0).
+ */
+struct IndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t header_bytes;
+  uint32_t index_bytes;
+  uint64_t length;
+  uint64_t text_offset;
+  uint64_t sa_offset;
+  uint64_t lcp_offset;
+  uint64_t buckets_offset;
+  uint64_t file_bytes;
+  uint64_t text_checksum;
+  uint64_t data_checksum;
+  uint64_t header_checksum;
+};
+
+/*
+ * Builds the suffix array and LCP array of the input with the engine, and
+ * writes them with the text into an index file. The file is written under
+ * a temporary name and renamed, so readers never see it half written. If
+ * the file already holds a compatible index of the same text, it is kept
+ * and reused is set. Returns false and sets the error on failure.
+ */
+bool BuildIndex(const Text& input, LcpEngine engine, const string& filename, bool& reused, string& error);
+
+/*
+ * Index file mapped into memory and used in place. Open only checks the
+ * header, which takes constant time; VerifyChecksums reads all sections.
+ */
+class LcpIndex {
+  public:
+  IndexHeader header;
+
+  LcpIndex();
+
+  /*
+   * Maps the index file and checks its header: magic, version, byte order,
+   * header checksum and section bounds. Returns false and sets the error if
+   * the file can't be used.
+   */
+  bool Open(const char *filename, string& error);
+
+  /*
+   * Checks the checksums of all sections, returns false and sets the error
+   * on a mismatch.
+   */
+  bool VerifyChecksums(string& error) const;
+
+  /*
+   * Unmaps the file.
+   */
+  void Close();
+
+  /*
+   * Returns the text, with its sentinel, in the mapped file.
+   */
+  Text text() const {
+    return Text(file.data + header.text_offset, header.length);
+  }
+
+  size_t length() const {
+    return header.length;
+  }
+
+  long long Sa(size_t i) const {
+    return header.index_bytes == 4 ? (long long)sa32()[i] : sa64()[i];
+  }
+
+  long long Lcp(size_t i) const {
+    return header.index_bytes == 4 ? (long long)lcp32()[i] : lcp64()[i];
+  }
+
+  /*
+   * The arrays, for indices with 4 or 8 bytes per value.
+   */
+  const int *sa32() const {
+    return (const int *)(file.data + header.sa_offset);
+  }
+
+  const int *lcp32() const {
+    return (const int *)(file.data + header.lcp_offset);
+  }
+
+  const long long *sa64() const {
+    return (const long long *)(file.data + header.sa_offset);
+  }
+
+  const long long *lcp64() const {
+    return (const long long *)(file.data + header.lcp_offset);
+  }
+
+  /*
+   * Returns the suffix array range [begin, end) of the suffixes starting
+   * with the character. The sentinel suffix, at slot 0, is in no range.
+   */
+  uint64_t BucketBegin(char c) const {
+    return Buckets()[(unsigned char)c];
+  }
+
+  uint64_t BucketEnd(char c) const {
+    return Buckets()[256 + (unsigned char)c];
+  }
+
+  private:
+  MappedFile file;
+
+  const uint64_t *Buckets() const {
+    return (const uint64_t *)(file.data + header.buckets_offset);
+  }
+
+  LcpIndex(const LcpIndex&);
+  LcpIndex& operator=(const LcpIndex&);
+};
+
+#endif
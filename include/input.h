@@ -0,0 +1,78 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "lcp.h"
+using std::string;
+using std::vector;
+
+/*
+ * Reads the input file up to the first whitespace, which is how the test
+ * inputs are stored. Returns false if the file can't be opened.
+ */
+bool ReadInput(const char *filename, string& text);
+
+/*
+ * What to do with newlines of a memory-mapped input.
+ */
+enum NewlineMode {
+  kFilterNewlines,
+  kSeparateNewlines
+};
+
+/*
+ * Private, writable memory mapping of a file, with room for one more byte
+ * after the end of the file. Changes are never written back to the file.
+ */
+class MappedFile {
+  public:
+  char *data;
+  size_t size;
+
+  MappedFile();
+  ~MappedFile();
+
+  /*
+   * Maps the file, returns false if it can't be opened or mapped.
+   */
+  bool Open(const char *filename);
+
+  /*
+   * Unmaps the file.
+   */
+  void Close();
+
+  private:
+  size_t mapped_size;
+
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+};
+
+/*
+ * Prepares the mapped bytes of a file as the input text, in place. Newlines
+ * are either dropped or turned into separators. The text ends at the first
+ * sentinel, or the sentinel is added at the end of the file.
+ */
+Text MappedText(MappedFile& file, NewlineMode mode);
+
+/*
+ * Sequence record of a FASTA or FASTQ file, and where its sequence is in
+ * the text made of all records.
+ */
+struct Record {
+  string name;
+  size_t start;
+  size_t length;
+};
+
+/*
+ * Parses the mapped FASTA or FASTQ file, in place, into one text made of
+ * the sequences of all records, separated by separators and ended by the
+ * sentinel. Records are returned in file order. Throws on malformed input.
+ */
+Text MappedRecords(MappedFile& file, vector<Record>& records);
+
+#endif
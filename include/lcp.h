@@ -1,25 +1,201 @@
 #ifndef LCP_H
 #define LCP_H
 
+#include <cstddef>
 #include <string>
 #include <vector>
+#include "packed.h"
 using std::string;
 using std::vector;
 
+/*
+ * Sentinel ending every input. The last character of a text is its
+ * sentinel whatever its byte: it sorts before all other characters and
+ * matches none, so the text itself may hold any bytes, '$' included.
+ */
+const char kSentinel = '$';
+
+/*
+ * Separator between records (or lines) of one input. Sorts right after the
+ * sentinel and before all letters and digits.
+ */
+const char kSeparator = '%';
+
+/*
+ * Longest input with 32-bit results (the int overloads below). Longer
+ * inputs need the long long overloads.
+ */
+const long long kMaxInt32Length = 2147483647;
+
+/*
+ * Read-only view of the input text. The construction runs directly on the
+ * viewed bytes, which can be a string, a memory-mapped file or any other
+ * buffer owned by the caller, or on a packed DNA text, in which case data
+ * is NULL. Like strings, inputs end with a '$' sentinel, and other
+ * characters are ordered as signed chars. Only the first 'stored'
+ * characters are read from data; a sentinel past them (see SentinelText)
+ * is implicit.
+ */
+class Text {
+  public:
+  const char *data;
+  size_t size;
+  const PackedDna *packed;
+  size_t stored;
+
+  Text(const char *data_, size_t size_) : data(data_), size(size_), packed(NULL), stored(size_) {}
+  Text(const string& str) : data(str.data()), size(str.length()), packed(NULL), stored(str.length()) {}
+  Text(const PackedDna& dna) : data(NULL), size(dna.size), packed(&dna), stored(dna.size) {}
+
+  char at(size_t i) const {
+    if (packed != NULL) {
+      return packed->at(i);
+    }
+    return i < stored ? data[i] : kSentinel;
+  }
+
+  char operator[](size_t i) const {
+    return at(i);
+  }
+
+  size_t length() const {
+    return size;
+  }
+};
+
+/*
+ * Returns the view of the size bytes at data, followed by a '$' sentinel
+ * that isn't stored, so buffers held by the caller are indexed without
+ * copying. The text is size + 1 characters long.
+ */
+inline Text SentinelText(const char *data, size_t size) {
+  Text text(data, size + 1);
+  text.stored = size;
+  return text;
+}
+
+/*
+ * Time spent in each phase of the construction, in nanoseconds. Times are
+ * added to, so one object can sum up several runs.
+ */
+struct PhaseTimes {
+  long long buckets;      // counting letters and laying out buckets
+  long long types;        // suffix type array
+  long long s_star;       // step 2.1, placing S* suffixes
+  long long induction;    // steps 2.2 and 2.3, inducing L and S suffixes
+  long long naming;       // step 3, naming and sorting S* suffixes, initial lcps
+  long long last_s_star;  // step 4.1, LastStepSStar
+  long long last_l;       // step 4.2, LastStepL
+  long long last_s;       // step 4.3, LastStepS
+  long long output;       // copying results to the output buffers
+  long long suffix_array; // plain SA-IS, for the Kasai and Phi engines
+  long long lcp_scan;     // the Kasai or Phi pass over the text
+
+  PhaseTimes() {
+    buckets = types = s_star = induction = naming = 0;
+    last_s_star = last_l = last_s = output = 0;
+    suffix_array = lcp_scan = 0;
+  }
+
+  void Add(const PhaseTimes& other) {
+    buckets += other.buckets;
+    types += other.types;
+    s_star += other.s_star;
+    induction += other.induction;
+    naming += other.naming;
+    last_s_star += other.last_s_star;
+    last_l += other.last_l;
+    last_s += other.last_s;
+    output += other.output;
+    suffix_array += other.suffix_array;
+    lcp_scan += other.lcp_scan;
+  }
+
+  long long Total() const {
+    return buckets + types + s_star + induction + naming + last_s_star + last_l + last_s + output +
+        suffix_array + lcp_scan;
+  }
+};
+
 /*
  * Runs tests with random strings.
  */
 void BatchTest();
 
+/*
+ * Sets the number of threads the construction may use, all cores by default.
+ */
+void SetConstructionThreads(int threads);
+
 /*
  * Calculates the LCP array for the given input string.
  */
-vector<int> CalculateLCP(string&);
+vector<int> CalculateLCP(const Text& input);
+
+template<class Index> class Workspace;
+
+/*
+ * Scratch buffers of the construction (buckets, suffix types, names, the
+ * reduced string and its SA-IS levels), owned by the caller and reused by
+ * every run on it, for many small inputs. Once the buffers have grown to
+ * the largest input, runs don't allocate. A context is for one thread at a
+ * time, and for inputs of up to kMaxInt32Length characters.
+ */
+class LcpContext {
+  public:
+  LcpContext();
+  ~LcpContext();
+
+  private:
+  Workspace<int> *workspace;
+
+  LcpContext(const LcpContext&);
+  LcpContext& operator=(const LcpContext&);
+
+  friend void CalculateSuffixArrayLCP(const Text& input, int* sa, int* lcp, LcpContext& context, PhaseTimes* times);
+};
+
+/*
+ * Same as CalculateSuffixArrayLCP below, in the buffers of the context.
+ */
+void CalculateSuffixArrayLCP(const Text& input, int* sa, int* lcp, LcpContext& context, PhaseTimes* times = NULL);
+
+/*
+ * Calculates the LCP array for the given input string into the result, in
+ * the buffers of the context. The result keeps its capacity as well.
+ */
+void CalculateLCP(const Text& input, LcpContext& context, vector<int>& result);
+
+/*
+ * Calculates the suffix array, the LCP array and the inverse suffix array
+ * for the given input string in one run. Results are written to the given
+ * buffers of input.length() elements; NULL buffers are skipped. If times is
+ * given, time spent in each phase is added to it. Throws if the input is
+ * longer than kMaxInt32Length.
+ */
+void CalculateSuffixArrayLCP(const Text& input, int* sa, int* lcp, int* isa = NULL, PhaseTimes* times = NULL);
+
+/*
+ * Same, with 64-bit results, for inputs of any length. Inputs that fit into
+ * 32 bits still run with 32-bit indices, which takes about half the memory.
+ */
+void CalculateSuffixArrayLCP(const Text& input, long long* sa, long long* lcp, long long* isa = NULL, PhaseTimes* times = NULL);
+
+/*
+ * Calculates the generalized suffix array and LCP array of an input made of
+ * several records, separated by kSeparator. LCP values stop at separators,
+ * as if every separator was a distinct character, and documents maps every
+ * suffix array slot to the record (0, 1, 2...) its suffix starts in; a
+ * separator belongs to the record it ends. All buffers have input.length()
+ * elements. The long long overload takes inputs of any length.
+ */
+void CalculateGeneralizedSuffixArrayLCP(const Text& input, int* sa, int* lcp, int* documents);
+void CalculateGeneralizedSuffixArrayLCP(const Text& input, long long* sa, long long* lcp, long long* documents);
 
 /*
  * Calculates the LCP value between suffixes with indicies a and b.
- */ 
-int Lcp(int a, int b, string& input);
+ */
+long long Lcp(long long a, long long b, const Text& input);
 
 /*
  * Prints out the given vector.
@@ -0,0 +1,50 @@
+#ifndef LIBLCP_H
+#define LIBLCP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "lcp.h"
+#include "engines.h"
+#include "succinct.h"
+#include "verify.h"
+#include "repeats.h"
+#include "index.h"
+#include "search.h"
+using std::vector;
+
+/*
+ * Interface of the liblcp library (make lib): the headers above, and the
+ * functions below for buffers of bytes the caller already holds, such as
+ * memory-mapped files or sequencing reads. The bytes are read in place and
+ * never copied or written; the '$' sentinel ending every input is implicit,
+ * so results are those of the bytes followed by '$', with n + 1 elements,
+ * the first of which is the sentinel suffix. The bytes may be anything,
+ * '$' included: the sentinel sorts before all of them and matches none,
+ * and the bytes are ordered as signed chars, so 0x80 to 0xff come before
+ * 0x00 to 0x7f, with every engine.
+ */
+
+/*
+ * Returns the text of the n bytes at data, with the implicit sentinel, for
+ * the functions taking a Text.
+ */
+inline Text BufferText(const uint8_t *data, size_t n) {
+  return SentinelText((const char *)data, n);
+}
+
+/*
+ * Calculates the suffix array and the LCP array of the n bytes at data with
+ * the given engine. Both buffers have n + 1 elements; the suffix array may
+ * be NULL. The int overload throws if n + 1 is longer than kMaxInt32Length.
+ */
+void CalculateSuffixArrayLCP(const uint8_t *data, size_t n, int* sa, int* lcp, LcpEngine engine = kAutoEngine);
+void CalculateSuffixArrayLCP(const uint8_t *data, size_t n, long long* sa, long long* lcp,
+    LcpEngine engine = kAutoEngine);
+
+/*
+ * Calculates the LCP array of the n bytes at data, n + 1 elements.
+ */
+vector<int> CalculateLCP(const uint8_t *data, size_t n);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include "engines.h"
+#include "input.h"
+#include "output.h"
+
+/*
+ * How the input files are read and the outputs written.
+ */
+struct Options {
+  bool use_mmap;
+  bool fasta;
+  bool dna;
+  NewlineMode newlines;
+  OutputFormat format;
+  LcpEngine engine;
+
+  Options() {
+    use_mmap = false;
+    fasta = false;
+    dna = false;
+    newlines = kFilterNewlines;
+    format = kTextOutput;
+    engine = kAutoEngine;
+  }
+};
+
+#endif
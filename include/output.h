@@ -0,0 +1,101 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+using std::vector;
+
+/*
+ * Formats of the output files.
+ *  - kTextOutput: decimal values, each followed by a space
+ *  - kInt32Output, kInt64Output: raw little-endian integers
+ *  - kPackedOutput: value count (little-endian uint64), one byte per value,
+ *    then every value >= 255 (marked with byte 255) as a little-endian
+ *    uint32, in order
+ *  - kVarintOutput: differences of neighbouring values, zigzag encoded as
+ *    LEB128 varints
+ */
+enum OutputFormat {
+  kTextOutput,
+  kInt32Output,
+  kInt64Output,
+  kPackedOutput,
+  kVarintOutput
+};
+
+/*
+ * Parses the format name (text, int32, int64, packed, varint), returns
+ * false for unknown names.
+ */
+bool ParseOutputFormat(const char *name, OutputFormat& format);
+
+/*
+ * Returns the file extension used for the format.
+ */
+const char *OutputExtension(OutputFormat format);
+
+/*
+ * Writes the values to the file in the given format. Returns false if the
+ * file can't be written, or if a value doesn't fit into the 32 bits of the
+ * int32 or packed format. Value is int or long long.
+ */
+template<class Value>
+bool WriteValues(const char *filename, const vector<Value>& values, OutputFormat format);
+
+/*
+ * Reads values written by WriteValues in the given format. Returns false if
+ * the file can't be read or is malformed. Value is int or long long.
+ */
+template<class Value>
+bool ReadValues(const char *filename, vector<Value>& values, OutputFormat format);
+
+class OutputBuffer;
+
+/*
+ * Writes values to a file one at a time, in the given format, for outputs
+ * too large to hold in memory. The packed format needs the number of
+ * values up front; its overflow table goes to a temporary file until
+ * Close.
+ */
+class ValueWriter {
+  public:
+  ValueWriter();
+  ~ValueWriter();
+
+  /*
+   * Creates the file, returns false if it can't be created.
+   */
+  bool Open(const char *filename, OutputFormat format, size_t count);
+
+  /*
+   * Writes the next value. A value that doesn't fit into the 32 bits of
+   * the int32 or packed format makes Close fail.
+   */
+  void Put(long long value);
+
+  /*
+   * Finishes the file. Returns false if anything failed to be written.
+   */
+  bool Close();
+
+  /*
+   * Returns the number of bytes written so far.
+   */
+  size_t Bytes() const;
+
+  private:
+  FILE *file;
+  FILE *overflow_file;
+  OutputBuffer *out;
+  OutputBuffer *overflow;
+  OutputFormat format;
+  long long previous;
+  bool failed;
+  size_t bytes;
+
+  ValueWriter(const ValueWriter&);
+  ValueWriter& operator=(const ValueWriter&);
+};
+
+#endif
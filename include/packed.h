@@ -0,0 +1,81 @@
+#ifndef PACKED_H
+#define PACKED_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+using std::vector;
+
+/*
+ * DNA text packed 2 bits per base, A, C, G and T as 0 to 3, 32 bases per
+ * 64-bit word with the first base in the highest bits. Any other character
+ * (N, lowercase bases, separators, the sentinel) is an exception: it is
+ * stored as A in the words, and kept with its position in a sorted side
+ * list. A bit per word tells whether the word holds any exception, so
+ * reading a base only searches the list in those words.
+ */
+class PackedDna {
+  public:
+  vector<uint64_t> words;
+  size_t size;
+  vector<size_t> exception_positions;
+  vector<char> exception_chars;
+  vector<uint64_t> exception_words;
+  size_t counts[256];
+
+  /*
+   * Packs the text of the given length.
+   */
+  PackedDna(const char *text, size_t length);
+
+  /*
+   * Returns the character at position i.
+   */
+  char at(size_t i) const {
+    if ((exception_words[i >> 11] >> ((i >> 5) & 63)) & 1) {
+      vector<size_t>::const_iterator it = std::lower_bound(exception_positions.begin(), exception_positions.end(), i);
+      if (it != exception_positions.end() && *it == i) {
+        return exception_chars[it - exception_positions.begin()];
+      }
+    }
+    return "ACGT"[(words[i >> 5] >> (62 - 2 * (i & 31))) & 3];
+  }
+
+  /*
+   * Returns the 32 bases starting at position i, the first in the highest
+   * bits. Bases past the end are A.
+   */
+  uint64_t Window(size_t i) const {
+    const size_t w = i >> 5;
+    const int shift = 2 * (i & 31);
+    if (shift == 0) {
+      return words[w];
+    }
+    return (words[w] << shift) | (words[w+1] >> (64 - shift));
+  }
+
+  /*
+   * Returns the position of the first exception at or after i, or the text
+   * size if there is none.
+   */
+  size_t NextException(size_t i) const {
+    vector<size_t>::const_iterator it = std::lower_bound(exception_positions.begin(), exception_positions.end(), i);
+    return it == exception_positions.end() ? size : *it;
+  }
+
+  /*
+   * Returns the length of the common prefix of the suffixes at a and b,
+   * looking at no more than 'length' characters. Runs of plain bases are
+   * compared 32 at a time, by XOR of windows and counting leading zeros,
+   * exceptions one by one.
+   */
+  size_t CommonPrefix(size_t a, size_t b, size_t length) const;
+
+  /*
+   * Returns the number of bytes used by the packed text.
+   */
+  size_t Bytes() const;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "counters.h"
+
+/*
+ * Total weight below which work is not worth splitting across threads.
+ */
+const long long kMinParallelWeight = 1 << 16;
+
+/*
+ * Splits [0, count) into consecutive ranges of about the same total weight,
+ * one per thread, and runs body(begin, end) for every range in parallel.
+ * weight_prefix[i] is the total weight of items before i, so it has
+ * count + 1 elements. Ranges are fixed by the weights alone, so the work
+ * each item gets doesn't depend on the thread count or on timing.
+ */
+template<class Body>
+void ParallelRanges(const std::vector<long long>& weight_prefix, int threads, Body body) {
+  const long long count = weight_prefix.size() - 1;
+  const long long total = weight_prefix[count];
+  if (threads < 2 || count < 2 || total < kMinParallelWeight) {
+    body(0, count);
+    return;
+  }
+  threads = (int)std::min((long long)threads, total / (kMinParallelWeight / 2));
+
+  std::vector<long long> bounds(threads + 1, count);
+  bounds[0] = 0;
+  for (int t = 1; t < threads; t++) {
+    long long target = total * t / threads;
+    bounds[t] = std::lower_bound(weight_prefix.begin(), weight_prefix.end(), target) - weight_prefix.begin();
+  }
+
+  OperationCounts *counts = ThreadOperationCounts();
+  std::vector<std::thread> workers;
+  for (int t = 1; t < threads; t++) {
+    if (bounds[t] < bounds[t+1]) {
+      workers.push_back(std::thread([&body, &bounds, counts, t]() {
+        body(bounds[t], bounds[t+1]);
+        MergeOperationCounts(counts);
+      }));
+    }
+  }
+  body(bounds[0], bounds[1]);
+  for (size_t t = 0; t < workers.size(); t++) {
+    workers[t].join();
+  }
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef REPEATS_H
+#define REPEATS_H
+
+#include <cstdio>
+#include <map>
+#include <vector>
+#include "engines.h"
+using std::map;
+using std::vector;
+
+/*
+ * A repeated substring: its length, number of occurrences, and the text
+ * position of one of them.
+ */
+struct Repeat {
+  long long position;
+  long long length;
+  long long count;
+
+  Repeat() : position(0), length(0), count(0) {}
+  Repeat(long long position_, long long length_, long long count_)
+      : position(position_), length(length_), count(count_) {}
+};
+
+/*
+ * What AnalyzeRepeats collects. Repeats shorter than min_length are not
+ * counted; the maximal and supermaximal ones are only kept if asked for.
+ * A kmer_length of 0 skips the k-mer spectrum. generalized tells that the
+ * arrays are those of the generalized construction, where every separator
+ * ends a record and acts as a distinct character.
+ */
+struct RepeatQuery {
+  long long min_length;
+  long long kmer_length;
+  bool keep_maximal;
+  bool keep_supermaximal;
+  bool generalized;
+
+  RepeatQuery() {
+    min_length = 1;
+    kmer_length = 0;
+    keep_maximal = false;
+    keep_supermaximal = false;
+    generalized = false;
+  }
+};
+
+/*
+ * Results of AnalyzeRepeats.
+ *  - longest: the longest repeated substring, length 0 if there is none
+ *  - maximal: repeats that can't be extended to the left or to the right
+ *    without losing an occurrence
+ *  - supermaximal: maximal repeats that aren't a substring of another
+ *    maximal repeat
+ *  - spectrum: for every frequency, the number of distinct k-mers occurring
+ *    that many times; k-mers spanning a separator or the sentinel are left
+ *    out
+ */
+struct RepeatAnalysis {
+  Repeat longest;
+  long long maximal_count;
+  long long supermaximal_count;
+  vector<Repeat> maximal;
+  vector<Repeat> supermaximal;
+  map<long long, long long> spectrum;
+
+  RepeatAnalysis() : maximal_count(0), supermaximal_count(0) {}
+};
+
+/*
+ * Analyzes the repeats of the input from its suffix array and LCP array
+ * (input.length() elements), in one bottom-up pass over the LCP intervals.
+ * Repeats of generalized arrays stop at record ends.
+ */
+void AnalyzeRepeats(const Text& input, const int* sa, const int* lcp, const RepeatQuery& query,
+    RepeatAnalysis& analysis);
+void AnalyzeRepeats(const Text& input, const long long* sa, const long long* lcp, const RepeatQuery& query,
+    RepeatAnalysis& analysis);
+
+/*
+ * Builds the suffix array and LCP array of the input with the engine, or
+ * with the generalized construction if the query is generalized, and
+ * analyzes its repeats. Arrays are 32-bit if the input is short enough.
+ */
+void IndexAndAnalyzeRepeats(const Text& input, LcpEngine engine, const RepeatQuery& query, RepeatAnalysis& analysis);
+
+/*
+ * Writes the repeats as lines of "length count position", and the spectrum
+ * as lines of "frequency k-mers".
+ */
+void WriteRepeats(FILE *file, const vector<Repeat>& repeats);
+void WriteSpectrum(FILE *file, const map<long long, long long>& spectrum);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef SAIS_H
+#define SAIS_H
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+using std::deque;
+using std::vector;
+
+/*
+ * Scratch buffers of one recursion level of SuffixArray.
+ */
+template<class Index>
+struct SaisLevel {
+  vector<bool> stype;
+  vector<Index> lms;
+  vector<Index> ordinal;
+  vector<Index> reduced;
+  vector<Index> reduced_sa;
+  vector<Index> sorted_lms;
+  vector<Index> borders;
+};
+
+/*
+ * Scratch buffers of SuffixArray, one set per recursion level. Kept
+ * between calls, repeated calls stop allocating once the buffers have
+ * grown to the largest string. Levels are a deque, so a level stays in
+ * place while deeper ones are added.
+ */
+template<class Index>
+struct SaisWorkspace {
+  deque<SaisLevel<Index> > levels;
+};
+
+/*
+ * Builds the suffix array of the string s over the integer alphabet
+ * [0, alphabet) with the SA-IS algorithm. The end of the string acts as
+ * a virtual sentinel, smaller than every symbol. Index is int or long
+ * long, depending on the length of the string.
+ */
+template<class Index>
+void SuffixArray(const vector<Index>& s, Index alphabet, vector<Index>& sa);
+
+/*
+ * Same, with the scratch buffers of the workspace, starting at the given
+ * recursion level.
+ */
+template<class Index>
+void SuffixArray(const vector<Index>& s, Index alphabet, vector<Index>& sa, SaisWorkspace<Index>& workspace,
+    size_t level = 0);
+
+#endif
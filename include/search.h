@@ -0,0 +1,68 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "index.h"
+using std::string;
+using std::vector;
+
+/*
+ * Positions reported per locate query unless the query says otherwise.
+ */
+const long long kDefaultLocateLimit = 1000;
+
+/*
+ * Suffix array range [begin, end) of the suffixes starting with a pattern.
+ */
+struct SuffixRange {
+  uint64_t begin;
+  uint64_t end;
+};
+
+/*
+ * Finds the suffixes of the index starting with the pattern. The bucket of
+ * the first character bounds the search, and both ends of the range are
+ * found by binary search with the mlr heuristic: the pattern is compared
+ * with a suffix from the shorter of its common prefixes with the two
+ * bounds, so no character of the pattern is compared twice against the
+ * same bound.
+ */
+SuffixRange FindPattern(const LcpIndex& index, const char *pattern, size_t length);
+
+/*
+ * A query of the search service.
+ *  - kCountQuery: "count PATTERN", answered with the number of occurrences
+ *  - kLocateQuery: "locate PATTERN [LIMIT]", answered with the number of
+ *    occurrences and the text positions of up to LIMIT of them
+ *  - kStatsQuery: "stats", answered with the queries served so far
+ */
+enum QueryKind {
+  kCountQuery,
+  kLocateQuery,
+  kStatsQuery
+};
+
+struct Query {
+  QueryKind kind;
+  string pattern;
+  long long limit;
+};
+
+/*
+ * Parses a request line, returns false and sets the error if it isn't a
+ * query.
+ */
+bool ParseQuery(const string& line, Query& query, string& error);
+
+/*
+ * Answers a batch of count and locate queries, split across threads,
+ * into one line per query (without newline), in the order of the queries.
+ * A count answer is the number of occurrences, a locate answer the number
+ * followed by the positions, in suffix array order.
+ */
+void AnswerQueries(const LcpIndex& index, const vector<Query>& queries, int threads, vector<string>& answers);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef SERVICE_H
+#define SERVICE_H
+
+#include <cstdio>
+#include <mutex>
+#include "search.h"
+
+/*
+ * Queries served and time spent answering them, over all connections.
+ */
+class ServiceStats {
+  public:
+  long long queries;
+  long long batches;
+  long long answer_ns;
+  long long start_ns;
+
+  ServiceStats();
+
+  /*
+   * Adds a batch.
+   */
+  void Add(long long batch_queries, long long ns);
+
+  /*
+   * Returns "<queries> queries in <batches> batches, <q> queries/s
+   * answering, <w> queries/s since the start".
+   */
+  string Summary();
+
+  private:
+  std::mutex mutex;
+};
+
+/*
+ * Serves queries from the in file descriptor until it ends, writing one
+ * answer line per request line to the out file descriptor. Every request
+ * line already received is answered as one batch, split across the
+ * threads, so a client may send any number of queries before reading the
+ * answers. Returns false if the answers can't be written.
+ */
+bool ServeStream(const LcpIndex& index, int in, int out, int threads, ServiceStats& stats);
+
+/*
+ * Listens on the Unix socket at path, and serves every connection with
+ * ServeStream on its own thread, until the process is stopped. A socket
+ * already at the path is replaced. Returns false and sets the error if the
+ * path holds any other file, or if the socket can't be created.
+ */
+bool ServeSocket(const LcpIndex& index, const char *path, int threads, ServiceStats& stats, string& error);
+
+#endif
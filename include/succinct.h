@@ -0,0 +1,59 @@
+#ifndef SUCCINCT_H
+#define SUCCINCT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+using std::vector;
+
+/*
+ * LCP array in about 2n bits, as the permuted LCP array (PLCP[SA[i]] =
+ * LCP[i]) in Sadakane's encoding. PLCP[j] + j never decreases with j, so
+ * bit PLCP[j] + 2j is set for every text position j, in a bitvector of 2n
+ * bits, and PLCP[j] = Select(j) - 2j. LCP values in suffix array order
+ * take the caller's suffix array, which query structures keep anyway.
+ * Select is answered from the number of ones before every 512-bit block
+ * and the block of every 512th one, about 0.4 more bits per character.
+ */
+class SuccinctLcp {
+  public:
+  vector<uint64_t> bits;
+  vector<uint64_t> block_ranks;
+  vector<uint64_t> select_samples;
+  size_t size;
+
+  /*
+   * Converts the dense suffix array and LCP array of n elements. Output is
+   * int or long long.
+   */
+  template<class Output>
+  SuccinctLcp(const Output* sa, const Output* lcp, size_t n);
+
+  /*
+   * Returns the LCP value of the suffix starting at the text position.
+   */
+  size_t Plcp(size_t position) const {
+    return Select(position) - 2 * position;
+  }
+
+  /*
+   * Returns LCP[i], the LCP value of the i-th suffix of the suffix array
+   * sa and the one before it.
+   */
+  template<class Output>
+  size_t Lcp(size_t i, const Output* sa) const {
+    return Plcp(sa[i]);
+  }
+
+  /*
+   * Returns the position of the k-th set bit, counting from 0.
+   */
+  size_t Select(size_t k) const;
+
+  /*
+   * Returns the number of bytes used.
+   */
+  size_t Bytes() const;
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <string>
+#include "lcp.h"
+#include "output.h"
+using std::string;
+
+/*
+ * Checks the suffix array and the LCP array of input.length() elements
+ * against the text in linear time: the suffix array must be a permutation,
+ * neighbouring suffixes must be in order by their first characters and the
+ * ranks of the suffixes after them, which makes the whole suffix array
+ * sorted, and every LCP value must match the one recomputed with the Phi
+ * algorithm. Returns false and describes the first failing check, in
+ * suffix array order, in the error.
+ */
+bool VerifySuffixArrayLCP(const Text& input, const int* sa, const int* lcp, string& error);
+bool VerifySuffixArrayLCP(const Text& input, const long long* sa, const long long* lcp, string& error);
+
+/*
+ * Checks an LCP array alone, against the suffix array built with plain
+ * SA-IS, which is checked as well.
+ */
+bool VerifyLCP(const Text& input, const int* lcp, string& error);
+bool VerifyLCP(const Text& input, const long long* lcp, string& error);
+
+/*
+ * Reads the LCP array, and the suffix array unless sa_filename is empty,
+ * from files in the given format and checks them against the input.
+ * Returns false and sets the error if a file can't be read or a check
+ * fails.
+ */
+bool VerifyFiles(const Text& input, const string& sa_filename, const string& lcp_filename, OutputFormat format,
+    string& error);
+
+#endif
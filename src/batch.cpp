@@ -0,0 +1,439 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+#include "batch.h"
+#include "counters.h"
+#include "lcp.h"
+#include "timer.h"
+
+/*
+ * Measured peak memory per input character of the inducing engine on inputs
+ * with an S* suffix at every other position, its worst case: the text, the
+ * split bucket suffixes and LCPs, the bit-packed suffix types, the names, the
+ * reduced string with its suffix array and the LCP output.
+ */
+const size_t kInducingBytesPerChar = 44;
+
+/*
+ * Same, for inputs too long for 32-bit indices. Everything except the text,
+ * the suffix types and the weight prefix doubles.
+ */
+const size_t kWideInducingBytesPerChar = 84;
+
+/*
+ * Measured peak memory per input character of the kasai and phi engines: the
+ * text, the mapped string, the SA-IS workspace and suffix array, the rank or
+ * Phi array and the LCP output.
+ */
+const size_t kScanBytesPerChar = 30;
+
+/*
+ * Same, for inputs too long for 32-bit indices.
+ */
+const size_t kWideScanBytesPerChar = 58;
+
+/*
+ * Extra memory per input character of FASTA/FASTQ inputs, for the suffix
+ * array, inverse suffix array and documents of the generalized index.
+ */
+const size_t kGeneralizedBytesPerChar = 12;
+
+/*
+ * IndexAndWrite with Value as the type of the results.
+ */
+template<class Value>
+bool IndexAndWriteAs(const Text& input, const Options& options, const string& lcp_filename, const string& document_filename, string& error) {
+  const size_t n = input.length();
+  vector<Value> output(n);
+  vector<Value> documents;
+  if (options.fasta) {
+    vector<Value> sa(n);
+    documents.resize(n);
+    CalculateGeneralizedSuffixArrayLCP(input, &sa[0], &output[0], &documents[0]);
+  } else {
+    CalculateSuffixArrayLCP(input, (Value*)NULL, &output[0], options.engine);
+  }
+
+  if (!WriteValues(lcp_filename.c_str(), output, options.format)) {
+    error = "could not write " + lcp_filename;
+    return false;
+  }
+  if (options.fasta && !WriteValues(document_filename.c_str(), documents, options.format)) {
+    error = "could not write " + document_filename;
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Runs the construction on the input, with the engine of the options or
+ * the generalized one for FASTA/FASTQ inputs, and writes the LCP array (and
+ * the documents) in the format of the options. Results are 32-bit if the
+ * input is short enough, and 64-bit otherwise. Returns false and sets the
+ * error if an output can't be written.
+ */
+bool IndexAndWrite(const Text& input, const Options& options, const string& lcp_filename, const string& document_filename, string& error) {
+  if ((long long)input.length() <= kMaxInt32Length) {
+    return IndexAndWriteAs<int>(input, options, lcp_filename, document_filename, error);
+  }
+  return IndexAndWriteAs<long long>(input, options, lcp_filename, document_filename, error);
+}
+
+BatchOptions::BatchOptions() {
+  threads = thread::hardware_concurrency();
+  if (threads < 1) {
+    threads = 1;
+  }
+  long pages = sysconf(_SC_PHYS_PAGES);
+  long page_size = sysconf(_SC_PAGESIZE);
+  memory_budget = pages > 0 && page_size > 0 ? (size_t)pages * page_size / 2 : (size_t)1 << 32;
+  output_directory = NULL;
+}
+
+/*
+ * One input file of the batch.
+ */
+struct BatchJob {
+  string input;
+  string output_prefix;
+  size_t size;
+  size_t memory;
+};
+
+/*
+ * Larger files first, then by name, so the schedule doesn't depend on the
+ * directory order.
+ */
+bool LargerJob(const BatchJob& a, const BatchJob& b) {
+  if (a.size != b.size) {
+    return a.size > b.size;
+  }
+  return a.input < b.input;
+}
+
+/*
+ * Returns true for outputs of the batch mode, so rerunning on a directory
+ * doesn't index them.
+ */
+bool IsBatchOutput(const string& name) {
+  return name.find(".lcp.") != string::npos || name.find(".document.") != string::npos;
+}
+
+/*
+ * Estimated peak memory per input character of indexing a file with the
+ * options. FASTA/FASTQ inputs always use the inducing engine, and auto picks
+ * phi.
+ */
+size_t EstimatedBytesPerChar(const Options& options, bool wide) {
+  if (options.fasta) {
+    return wide ? kWideInducingBytesPerChar + 2 * kGeneralizedBytesPerChar : kInducingBytesPerChar + kGeneralizedBytesPerChar;
+  }
+  if (options.engine == kInducingEngine) {
+    return wide ? kWideInducingBytesPerChar : kInducingBytesPerChar;
+  }
+  return wide ? kWideScanBytesPerChar : kScanBytesPerChar;
+}
+
+/*
+ * Adds the file as a job, if it is a regular file. Returns false otherwise.
+ */
+bool AddJob(const string& filename, const Options& options, const BatchOptions& batch, vector<BatchJob>& jobs) {
+  struct stat st;
+  if (stat(filename.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+    return false;
+  }
+
+  BatchJob job;
+  job.input = filename;
+  job.size = st.st_size;
+  job.memory = job.size * EstimatedBytesPerChar(options, (long long)job.size > kMaxInt32Length);
+
+  string name = filename;
+  size_t slash = filename.rfind('/');
+  if (batch.output_directory != NULL) {
+    if (slash != string::npos) {
+      name = filename.substr(slash + 1);
+    }
+    name = string(batch.output_directory) + "/" + name;
+  }
+  job.output_prefix = name;
+  jobs.push_back(job);
+  return true;
+}
+
+/*
+ * Collects the jobs of a directory or of a file list. Returns false if the
+ * path can't be read; files of a list that are missing are reported,
+ * counted and skipped.
+ */
+bool CollectJobs(const char *path, const Options& options, const BatchOptions& batch, vector<BatchJob>& jobs, int& missing) {
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    return false;
+  }
+
+  if (S_ISDIR(st.st_mode)) {
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+      return false;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+      string name = entry->d_name;
+      if (name[0] == '.' || IsBatchOutput(name)) {
+        continue;
+      }
+      AddJob(string(path) + "/" + name, options, batch, jobs);
+    }
+    closedir(dir);
+    return true;
+  }
+
+  ifstream list(path);
+  if (!list.good()) {
+    return false;
+  }
+  string line;
+  while (getline(list, line)) {
+    if (!line.empty() && line[line.length()-1] == '\r') {
+      line.erase(line.length()-1);
+    }
+    if (line.empty()) {
+      continue;
+    }
+    if (!AddJob(line, options, batch, jobs)) {
+      printf("Skipping %s: not a readable file\n", line.c_str());
+      missing++;
+    }
+  }
+  return true;
+}
+
+/*
+ * Memory that running jobs have reserved. A job waits until its estimate
+ * fits into the budget, unless nothing else is running, so a job larger
+ * than the whole budget still runs, alone.
+ */
+class MemoryBudget {
+  public:
+  size_t budget;
+  size_t used;
+  int running;
+  mutex lock;
+  condition_variable released;
+
+  MemoryBudget(size_t budget_) {
+    budget = budget_;
+    used = 0;
+    running = 0;
+  }
+
+  void Acquire(size_t bytes) {
+    unique_lock<mutex> guard(lock);
+    while (running > 0 && used + bytes > budget) {
+      released.wait(guard);
+    }
+    used += bytes;
+    running++;
+  }
+
+  void Release(size_t bytes) {
+    {
+      lock_guard<mutex> guard(lock);
+      used -= bytes;
+      running--;
+    }
+    released.notify_all();
+  }
+};
+
+/*
+ * Job queue of one worker. The owner and idle workers both take jobs from
+ * the front, so the largest remaining job is always taken first.
+ */
+struct WorkerQueue {
+  mutex lock;
+  deque<int> jobs;
+};
+
+/*
+ * State shared by the worker threads.
+ */
+class BatchPool {
+  public:
+  const vector<BatchJob>& jobs;
+  const Options& options;
+  vector<WorkerQueue> queues;
+  MemoryBudget memory;
+  mutex print_lock;
+  int done;
+  int failed;
+
+  BatchPool(const vector<BatchJob>& jobs_, const Options& options_, int threads, size_t budget)
+      : jobs(jobs_), options(options_), queues(threads), memory(budget) {
+    done = 0;
+    failed = 0;
+    // jobs are sorted largest first, and dealt out in turn, every queue is
+    // sorted too
+    for (int i = 0; i < (int)jobs.size(); i++) {
+      queues[i % threads].jobs.push_back(i);
+    }
+  }
+
+/*
+ * Takes the next job of the worker, from the front of its own queue or, if
+ * that is empty, of another worker's. Returns -1 when no jobs are left.
+ */
+  int Next(int worker) {
+    const int n = queues.size();
+    for (int k = 0; k < n; k++) {
+      WorkerQueue& queue = queues[(worker + k) % n];
+      lock_guard<mutex> guard(queue.lock);
+      if (!queue.jobs.empty()) {
+        int job = queue.jobs.front();
+        queue.jobs.pop_front();
+        return job;
+      }
+    }
+    return -1;
+  }
+
+  void Work(int worker) {
+    for (int job = Next(worker); job != -1; job = Next(worker)) {
+      memory.Acquire(jobs[job].memory);
+      Process(jobs[job]);
+      memory.Release(jobs[job].memory);
+    }
+  }
+
+/*
+ * Reads, indexes and writes out one file.
+ */
+  void Process(const BatchJob& job) {
+    long long start = Nanoseconds();
+    ResetOperationCounts();
+    string error;
+    size_t length = 0;
+    try {
+      length = IndexFile(job, error);
+    } catch (string e) {
+      error = e;
+    } catch (const bad_alloc&) {
+      error = "out of memory";
+    } catch (const exception& e) {
+      error = e.what();
+    }
+    long long elapsed = Nanoseconds() - start;
+
+    lock_guard<mutex> guard(print_lock);
+    done++;
+    if (!error.empty()) {
+      failed++;
+      printf("[%d/%d] %s: %s\n", done, (int)jobs.size(), job.input.c_str(), error.c_str());
+      return;
+    }
+    printf("[%d/%d] %s: %lu chars, %.2f ms\n", done, (int)jobs.size(), job.input.c_str(),
+        (unsigned long)length, elapsed / 1e6);
+    PrintOperationCounts(length);
+    fflush(stdout);
+  }
+
+/*
+ * Indexes the file and writes its outputs. Returns the text length, or
+ * sets the error.
+ */
+  size_t IndexFile(const BatchJob& job, string& error) {
+    string line;
+    MappedFile mapped;
+    Text input(line);
+    vector<Record> records;
+
+    if (options.fasta || options.use_mmap) {
+      if (!mapped.Open(job.input.c_str())) {
+        error = "could not open the file";
+        return 0;
+      }
+      input = options.fasta ? MappedRecords(mapped, records) : MappedText(mapped, options.newlines);
+    } else {
+      if (!ReadInput(job.input.c_str(), line)) {
+        error = "could not open the file";
+        return 0;
+      }
+      input = Text(line);
+    }
+    if (input.length() == 0 || input[input.length()-1] != kSentinel) {
+      error = string("the input doesn't end with the sentinel ") + kSentinel;
+      return 0;
+    }
+    unique_ptr<PackedDna> dna;
+    if (options.dna) {
+      dna.reset(new PackedDna(input.data, input.length()));
+      input = Text(*dna);
+      string().swap(line);
+      mapped.Close();
+    }
+
+    const string extension = OutputExtension(options.format);
+    if (!IndexAndWrite(input, options, job.output_prefix + ".lcp." + extension,
+        job.output_prefix + ".document." + extension, error)) {
+      return 0;
+    }
+    return input.length();
+  }
+};
+
+/*
+ * Indexes many independent input files in parallel. The path is either a
+ * directory, whose regular files are all inputs, or a file listing one
+ * input path per line. Files are sorted largest first and dealt out round
+ * robin to the queues of a pool of threads, and a thread whose queue is
+ * empty takes from the front of the others. The outputs of each file are
+ * written as soon as it is done, to <name>.lcp.<extension> (and
+ * <name>.document.<extension> for FASTA/FASTQ inputs). Returns non-zero if
+ * any file failed.
+ */
+int RunBatch(const char *path, const Options& options, const BatchOptions& batch) {
+  vector<BatchJob> jobs;
+  int missing = 0;
+  if (!CollectJobs(path, options, batch, jobs, missing)) {
+    printf("Could not read %s\n", path);
+    return 1;
+  }
+  sort(jobs.begin(), jobs.end(), LargerJob);
+
+  const int threads = max(1, min(batch.threads, (int)jobs.size()));
+  printf("Files: %d\nThreads: %d\nMemory budget: %lu MB\n", (int)jobs.size(), threads,
+      (unsigned long)(batch.memory_budget >> 20));
+
+  // files run in parallel, each construction on one thread
+  if (threads > 1) {
+    SetConstructionThreads(1);
+  }
+  long long start = Nanoseconds();
+  BatchPool pool(jobs, options, threads, batch.memory_budget);
+  vector<thread> workers;
+  for (int i = 0; i < threads; i++) {
+    workers.push_back(thread(&BatchPool::Work, &pool, i));
+  }
+  for (int i = 0; i < threads; i++) {
+    workers[i].join();
+  }
+
+  printf("Done: %d files, %d failed, %d missing, %.2f s\n", (int)jobs.size(), pool.failed,
+      missing, (Nanoseconds() - start) / 1e9);
+  return pool.failed > 0 || missing > 0 ? 1 : 0;
+}
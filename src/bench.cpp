@@ -0,0 +1,357 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+using namespace std;
+
+#include "bench.h"
+#include "counters.h"
+#include "engines.h"
+#include "input.h"
+#include "lcp.h"
+#include "timer.h"
+
+/*
+ * Number of runs per input, the fastest one is reported.
+ */
+const int kBenchRuns = 3;
+
+/*
+ * Result of benchmarking one input.
+ */
+struct BenchResult {
+  string name;
+  LcpEngine engine;
+  int length;
+  PhaseTimes times;
+  long peak_rss_kb;
+};
+
+/*
+ * Small deterministic generator, so synthetic inputs are the same on every
+ * machine and every run.
+ */
+class BenchRandom {
+  public:
+  unsigned long long state;
+
+  BenchRandom(unsigned long long seed) {
+    state = seed;
+  }
+
+  unsigned int Next() {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return state >> 33;
+  }
+};
+
+/*
+ * Random string of the given length over the given letters, with sentinel.
+ */
+string RandomText(int length, const char *letters, unsigned long long seed) {
+  BenchRandom random(seed);
+  const int sigma = strlen(letters);
+  string text(length, ' ');
+  for (int i = 0; i < length; i++) {
+    text[i] = letters[random.Next() % sigma];
+  }
+  return text + kSentinel;
+}
+
+/*
+ * Tandem repeats of a random unit, with about one mutation per hundred
+ * letters, with sentinel.
+ */
+string TandemRepeatText(int length, int unit, unsigned long long seed) {
+  BenchRandom random(seed);
+  string period = RandomText(unit, "ACGT", seed + 1);
+  string text(length, ' ');
+  for (int i = 0; i < length; i++) {
+    text[i] = random.Next() % 100 == 0 ? "ACGT"[random.Next() % 4] : period[i % unit];
+  }
+  return text + kSentinel;
+}
+
+/*
+ * Prefix of the Fibonacci word over {A, C}, with sentinel.
+ */
+string FibonacciText(int length) {
+  string a = "A", b = "AC";
+  while ((int)b.length() < length) {
+    string next = b + a;
+    a = b;
+    b = next;
+  }
+  return b.substr(0, length) + kSentinel;
+}
+
+/*
+ * Resets the peak resident set size of the process, where supported.
+ */
+void ResetPeakRss() {
+  FILE *file = fopen("/proc/self/clear_refs", "w");
+  if (file != NULL) {
+    fputs("5", file);
+    fclose(file);
+  }
+}
+
+/*
+ * Returns the peak resident set size of the process in kilobytes.
+ */
+long PeakRssKb() {
+  FILE *file = fopen("/proc/self/status", "r");
+  if (file != NULL) {
+    char line[256];
+    long kb = -1;
+    while (fgets(line, sizeof(line), file) != NULL) {
+      if (sscanf(line, "VmHWM: %ld kB", &kb) == 1) {
+        break;
+      }
+    }
+    fclose(file);
+    if (kb >= 0) {
+      return kb;
+    }
+  }
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+/*
+ * Runs the engine on the text kBenchRuns times, and returns the times of
+ * the fastest run.
+ */
+BenchResult BenchmarkText(const string& name, const Text& text, LcpEngine engine) {
+  BenchResult result;
+  result.name = name;
+  result.engine = engine;
+  result.length = text.length();
+
+  ResetPeakRss();
+  vector<int> sa(text.length()), lcp(text.length());
+  for (int run = 0; run < kBenchRuns; run++) {
+    PhaseTimes times;
+    ResetOperationCounts();
+    CalculateSuffixArrayLCP(text, &sa[0], &lcp[0], engine, &times);
+    if (run == 0 || times.Total() < result.times.Total()) {
+      result.times = times;
+    }
+  }
+  result.peak_rss_kb = PeakRssKb();
+  return result;
+}
+
+/*
+ * Megabytes of input per second.
+ */
+double Throughput(const BenchResult& result) {
+  long long total = result.times.Total();
+  return total > 0 ? result.length * 1e3 / total : 0;
+}
+
+/*
+ * Prints one result as a table row.
+ */
+void PrintResult(const BenchResult& r) {
+  const PhaseTimes& t = r.times;
+  if (r.engine != kInducingEngine) {
+    printf("%-18s %-8s %9d %9.2f %8.2f %9ld  sa %.2f, lcp %.2f, output %.2f\n",
+        r.name.c_str(), LcpEngineName(r.engine), r.length, t.Total() / 1e6, Throughput(r),
+        r.peak_rss_kb, t.suffix_array / 1e6, t.lcp_scan / 1e6, t.output / 1e6);
+    return;
+  }
+  printf("%-18s %-8s %9d %9.2f %8.2f %9ld  %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f\n",
+      r.name.c_str(), LcpEngineName(r.engine), r.length, t.Total() / 1e6, Throughput(r),
+      r.peak_rss_kb, t.buckets / 1e6, t.types / 1e6, t.s_star / 1e6, t.induction / 1e6,
+      t.naming / 1e6, t.last_s_star / 1e6, t.last_l / 1e6, t.last_s / 1e6, t.output / 1e6);
+}
+
+/*
+ * Runs every engine on the text, and prints which one the automatic choice
+ * takes and which one was the fastest.
+ */
+void BenchmarkEngines(const string& name, const Text& text, vector<BenchResult>& results) {
+  const LcpEngine engines[] = {kInducingEngine, kKasaiEngine, kPhiEngine};
+  int fastest = -1;
+  for (int i = 0; i < 3; i++) {
+    results.push_back(BenchmarkText(name, text, engines[i]));
+    PrintResult(results.back());
+    PrintOperationCounts(text.length());
+    if (fastest < 0 || results.back().times.Total() < results[fastest].times.Total()) {
+      fastest = results.size() - 1;
+    }
+  }
+  printf("%-18s auto picks %s, fastest %s\n", name.c_str(), LcpEngineName(DefaultLcpEngine()),
+      LcpEngineName(results[fastest].engine));
+}
+
+/*
+ * Builds the arrays of many short random reads with the inducing engine,
+ * each with fresh buffers and then all through one LcpContext, and prints
+ * reads per second of both. The reads are timed in chunks, with the two
+ * ways taking turns on every chunk and each going first every other time,
+ * so neither is favoured by warmer caches or a quieter moment of the
+ * machine. The fastest of the runs of every chunk counts, by wall time,
+ * which includes the allocations and frees that phase times miss. The
+ * results hold the phase times of those runs.
+ */
+void BenchmarkReads(vector<BenchResult>& results) {
+  const int kReads = 4000;
+  const int kChunkReads = 100;
+  vector<string> reads;
+  BenchRandom random(4);
+  long long total_length = 0;
+  for (int i = 0; i < kReads; i++) {
+    reads.push_back(RandomText(100 + random.Next() % 9901, "ACGT", 5 + i));
+    total_length += reads.back().length();
+  }
+
+  vector<int> sa(10001), lcp(10001);
+  LcpContext context;
+  const char *names[] = {"reads-fresh", "reads-context"};
+  BenchResult modes[2];
+  long long wall[2] = {0, 0};
+  for (int i = 0; i < 2; i++) {
+    modes[i].name = names[i];
+    modes[i].engine = kInducingEngine;
+    modes[i].length = total_length;
+  }
+  ResetPeakRss();
+  for (int chunk = 0; chunk < kReads; chunk += kChunkReads) {
+    long long chunk_wall[2] = {0, 0};
+    PhaseTimes chunk_times[2];
+    for (int run = 0; run < 2 * kBenchRuns; run++) {
+      const int i = (run + run / 2) % 2;
+      PhaseTimes times;
+      const long long start = Nanoseconds();
+      for (int r = chunk; r < chunk + kChunkReads; r++) {
+        const Text text(reads[r]);
+        if (i == 0) {
+          CalculateSuffixArrayLCP(text, &sa[0], &lcp[0], kInducingEngine, &times);
+        } else {
+          CalculateSuffixArrayLCP(text, &sa[0], &lcp[0], context, &times);
+        }
+      }
+      const long long elapsed = Nanoseconds() - start;
+      if (chunk_wall[i] == 0 || elapsed < chunk_wall[i]) {
+        chunk_wall[i] = elapsed;
+        chunk_times[i] = times;
+      }
+    }
+    for (int i = 0; i < 2; i++) {
+      wall[i] += chunk_wall[i];
+      modes[i].times.Add(chunk_times[i]);
+    }
+  }
+  for (int i = 0; i < 2; i++) {
+    modes[i].peak_rss_kb = PeakRssKb();
+    results.push_back(modes[i]);
+    PrintResult(modes[i]);
+  }
+  printf("%-18s %d reads of 100-10000 bp: %.0f reads/s fresh, %.0f reads/s with a context\n", "reads",
+      kReads, kReads * 1e9 / wall[0], kReads * 1e9 / wall[1]);
+}
+
+/*
+ * Escapes the text for a JSON string: quotes, backslashes and control
+ * characters.
+ */
+string JsonEscape(const string& text) {
+  string escaped;
+  for (size_t i = 0; i < text.length(); i++) {
+    const unsigned char c = text[i];
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    } else if (c < 0x20) {
+      char code[8];
+      snprintf(code, sizeof(code), "\\u%04x", c);
+      escaped += code;
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+/*
+ * Writes all results as JSON.
+ */
+bool WriteJson(const char *filename, const char *label, vector<BenchResult>& results) {
+  FILE *file = fopen(filename, "w");
+  if (file == NULL) {
+    return false;
+  }
+
+  fprintf(file, "{\n  \"label\": \"%s\",\n  \"runs\": %d,\n  \"inputs\": [\n", JsonEscape(label).c_str(),
+      kBenchRuns);
+  for (int i = 0; i < (int)results.size(); i++) {
+    const BenchResult& r = results[i];
+    const PhaseTimes& t = r.times;
+    fprintf(file, "    {\"name\": \"%s\", \"engine\": \"%s\", \"length\": %d, \"total_ns\": %lld, "
+        "\"mb_per_s\": %.3f, \"peak_rss_kb\": %ld,\n", JsonEscape(r.name).c_str(), LcpEngineName(r.engine),
+        r.length, t.Total(), Throughput(r), r.peak_rss_kb);
+    fprintf(file, "     \"phases_ns\": {\"buckets\": %lld, \"types\": %lld, \"s_star\": %lld, "
+        "\"induction\": %lld, \"naming\": %lld, \"last_s_star\": %lld, \"last_l\": %lld, "
+        "\"last_s\": %lld, \"output\": %lld, \"suffix_array\": %lld, \"lcp_scan\": %lld}}%s\n",
+        t.buckets, t.types, t.s_star, t.induction, t.naming, t.last_s_star, t.last_l, t.last_s,
+        t.output, t.suffix_array, t.lcp_scan, i + 1 < (int)results.size() ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+  return fclose(file) == 0;
+}
+
+/*
+ * Runs the benchmark on the input(1,2,3...).txt files of the directory and
+ * on synthetic inputs. Prints per-phase times, throughput and peak RSS of
+ * every input, and writes them as JSON if json_filename is not NULL, tagged
+ * with the label (e.g. a commit id). Returns non-zero on failure.
+ */
+int Benchmark(const char *directory, const char *json_filename, const char *label) {
+  vector<BenchResult> results;
+  printf("%-18s %-8s %9s %9s %8s %9s  %s\n", "input", "engine", "length", "total ms", "MB/s", "peak KB",
+      "phases ms: buckets types s* induction naming last_s* last_l last_s output");
+
+  for (int i = 1; ; i++) {
+    char filename[1024];
+    snprintf(filename, sizeof(filename), "%s/input%d.txt", directory, i);
+    string text;
+    if (!ReadInput(filename, text)) {
+      break;
+    }
+    snprintf(filename, sizeof(filename), "input%d", i);
+    BenchmarkEngines(filename, text, results);
+  }
+
+  const int kSize = 1 << 20;
+  const char *names[] = {"random-dna", "random-protein", "tandem-repeat", "fibonacci", "poly-a",
+      "random-dna-2bit", "tandem-repeat-2bit"};
+  for (int i = 0; i < 7; i++) {
+    string text;
+    switch (i) {
+      case 0: case 5: text = RandomText(4 * kSize, "ACGT", 1); break;
+      case 1: text = RandomText(kSize, "ACDEFGHIKLMNPQRSTVWY", 2); break;
+      case 2: case 6: text = TandemRepeatText(kSize, 37, 3); break;
+      case 3: text = FibonacciText(kSize); break;
+      case 4: text = string(kSize, 'A') + kSentinel; break;
+    }
+    if (i >= 5) {
+      // the same texts, packed 2 bits per base
+      PackedDna dna(text.data(), text.length());
+      BenchmarkEngines(names[i], Text(dna), results);
+    } else {
+      BenchmarkEngines(names[i], text, results);
+    }
+  }
+  BenchmarkReads(results);
+
+  if (json_filename != NULL && !WriteJson(json_filename, label, results)) {
+    printf("Could not write %s\n", json_filename);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,78 @@
+#include <cstdio>
+#include <mutex>
+using namespace std;
+
+#include "counters.h"
+
+#ifdef COUNTERS_ENABLED
+thread_local OperationCounts operation_counts;
+
+/*
+ * Guards merging of counts from several helper threads.
+ */
+mutex merge_lock;
+
+/*
+ * Sets all counts of this thread to zero.
+ */
+void ResetOperationCounts() {
+  operation_counts = OperationCounts();
+}
+
+/*
+ * Returns the counts of this thread.
+ */
+OperationCounts *ThreadOperationCounts() {
+  return &operation_counts;
+}
+
+/*
+ * Adds the counts of this thread to the given counts of another thread.
+ */
+void MergeOperationCounts(OperationCounts *into) {
+  const OperationCounts& c = operation_counts;
+  lock_guard<mutex> guard(merge_lock);
+  into->lcp_chars += c.lcp_chars;
+  into->name_chars += c.name_chars;
+  into->min_lcp_scans += c.min_lcp_scans;
+  into->border_updates += c.border_updates;
+  into->bucket_lookups += c.bucket_lookups;
+}
+
+/*
+ * Prints one count, in total and per input character.
+ */
+void PrintCount(const char *name, long long count, size_t length) {
+  printf("  %-20s %14lld %10.2f/char\n", name, count, length > 0 ? (double)count / length : 0.0);
+}
+
+/*
+ * Prints the counts of this thread, in total and per character of an input
+ * of the given length.
+ */
+void PrintOperationCounts(size_t length) {
+  const OperationCounts& c = operation_counts;
+  printf("Operation counts:\n");
+  PrintCount("lcp chars", c.lcp_chars, length);
+  PrintCount("name chars", c.name_chars, length);
+  PrintCount("min-lcp pops", c.min_lcp_scans, length);
+  PrintCount("UpdateBorder", c.border_updates, length);
+  PrintCount("GetBucket", c.bucket_lookups, length);
+}
+#else
+void ResetOperationCounts() {
+  
+}
+
+OperationCounts *ThreadOperationCounts() {
+  return NULL;
+}
+
+void MergeOperationCounts(OperationCounts *into) {
+  
+}
+
+void PrintOperationCounts(size_t length) {
+  
+}
+#endif
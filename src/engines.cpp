@@ -0,0 +1,203 @@
+#include <cstring>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "engines.h"
+#include "sais.h"
+#include "timer.h"
+
+/*
+ * Parses the engine name (auto, inducing, kasai, phi), returns false for
+ * unknown names.
+ */
+bool ParseLcpEngine(const char *name, LcpEngine& engine) {
+  const char *names[] = {"auto", "inducing", "kasai", "phi"};
+  const LcpEngine engines[] = {kAutoEngine, kInducingEngine, kKasaiEngine, kPhiEngine};
+  for (int i = 0; i < 4; i++) {
+    if (strcmp(name, names[i]) == 0) {
+      engine = engines[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * Returns the name of the engine.
+ */
+const char *LcpEngineName(LcpEngine engine) {
+  switch (engine) {
+    case kInducingEngine: return "inducing";
+    case kKasaiEngine: return "kasai";
+    case kPhiEngine: return "phi";
+    default: return "auto";
+  }
+}
+
+/*
+ * Returns the engine that auto stands for. Phi was, on every input of the
+ * benchmark, short or long, repetitive or not, the fastest engine or within
+ * the noise of it: both scan engines build the same suffix array, and Phi's
+ * lcp pass reads its array in text order, while Kasai's reads the suffix
+ * array and writes the LCP array at the rank of every position. Kasai wins
+ * some runs by as little, and no measure of size or repetitiveness told
+ * those inputs apart. The inducing engine is slower on all of them.
+ */
+LcpEngine DefaultLcpEngine() {
+  return kPhiEngine;
+}
+
+/*
+ * Adds the time since the clock to the phase, and restarts the clock.
+ */
+inline void AddTime(long long& phase, long long& clock) {
+  long long now = Nanoseconds();
+  phase += now - clock;
+  clock = now;
+}
+
+/*
+ * Builds the suffix array of the input with plain SA-IS, over the
+ * characters shifted to keep their signed order, like the inducing engine
+ * and the verifier, after the sentinel at the end, which comes first.
+ */
+template<class Index>
+void PlainSuffixArray(const Text& input, vector<Index>& sa) {
+  const Index n = input.length();
+  vector<Index> s(n);
+  for (Index i = 0; i < n - 1; i++) {
+    s[i] = (signed char)input[i] + 129;
+  }
+  s[n-1] = 0;
+  sa.resize(n);
+  SuffixArray(s, (Index)257, sa);
+}
+
+/*
+ * Kasai's algorithm: suffixes are visited in text order, and the lcp of
+ * each with its predecessor in the suffix array is at least the previous
+ * one minus one.
+ */
+template<class Index, class Output>
+void KasaiLcp(const Text& input, const vector<Index>& sa, Output* lcp) {
+  const Index n = sa.size();
+  vector<Index> rank(n);
+  for (Index i = 0; i < n; i++) {
+    rank[sa[i]] = i;
+  }
+
+  Index h = 0;
+  for (Index i = 0; i < n; i++) {
+    if (rank[i] == 0) {
+      lcp[0] = 0;
+      h = 0;
+      continue;
+    }
+    const Index j = sa[rank[i] - 1];
+    h += Lcp(i + h, j + h, input);
+    lcp[rank[i]] = h;
+    if (h > 0) {
+      h--;
+    }
+  }
+}
+
+/*
+ * The Phi algorithm: Phi maps every suffix to its predecessor in the
+ * suffix array, the permuted LCP array is computed over it in text order,
+ * in place, and then permuted into suffix array order.
+ */
+template<class Index, class Output>
+void PhiLcp(const Text& input, const vector<Index>& sa, Output* lcp) {
+  const Index n = sa.size();
+  vector<Index> phi(n);
+  phi[sa[0]] = -1;
+  for (Index i = 1; i < n; i++) {
+    phi[sa[i]] = sa[i-1];
+  }
+
+  Index h = 0;
+  for (Index i = 0; i < n; i++) {
+    if (phi[i] == -1) {
+      phi[i] = 0;
+      h = 0;
+      continue;
+    }
+    h += Lcp(i + h, phi[i] + h, input);
+    phi[i] = h;
+    if (h > 0) {
+      h--;
+    }
+  }
+
+  for (Index i = 0; i < n; i++) {
+    lcp[i] = phi[sa[i]];
+  }
+}
+
+/*
+ * Runs the Kasai or Phi engine with Index as the type of the suffix array
+ * and the temporary arrays.
+ */
+template<class Index, class Output>
+void RunScanEngine(const Text& input, Output* sa, Output* lcp, LcpEngine engine, PhaseTimes& times) {
+  long long clock = Nanoseconds();
+  vector<Index> suffixes;
+  PlainSuffixArray(input, suffixes);
+  AddTime(times.suffix_array, clock);
+
+  if (engine == kKasaiEngine) {
+    KasaiLcp(input, suffixes, lcp);
+  } else {
+    PhiLcp(input, suffixes, lcp);
+  }
+  AddTime(times.lcp_scan, clock);
+
+  if (sa != NULL) {
+    copy(suffixes.begin(), suffixes.end(), sa);
+  }
+  AddTime(times.output, clock);
+}
+
+/*
+ * Runs the engine, the default one if it is kAutoEngine.
+ */
+template<class Output>
+void RunEngine(const Text& input, Output* sa, Output* lcp, LcpEngine engine, PhaseTimes* times) {
+  if (input.length() == 0) {
+    return;
+  }
+  if (engine == kAutoEngine) {
+    engine = DefaultLcpEngine();
+  }
+  if (engine == kInducingEngine) {
+    CalculateSuffixArrayLCP(input, sa, lcp, (Output*)NULL, times);
+    return;
+  }
+
+  PhaseTimes unused_times;
+  PhaseTimes& phase = times != NULL ? *times : unused_times;
+  if ((long long)input.length() <= kMaxInt32Length) {
+    RunScanEngine<int>(input, sa, lcp, engine, phase);
+  } else {
+    RunScanEngine<long long>(input, sa, lcp, engine, phase);
+  }
+}
+
+/*
+ * Calculates the suffix array and the LCP array of the input with the given
+ * engine. Both buffers have input.length() elements; the suffix array may
+ * be NULL. If times is given, time spent in each phase is added to it.
+ * The int overload throws if the input is longer than kMaxInt32Length.
+ */
+void CalculateSuffixArrayLCP(const Text& input, int* sa, int* lcp, LcpEngine engine, PhaseTimes* times) {
+  if ((long long)input.length() > kMaxInt32Length) {
+    throw string("Input too long for 32-bit results, use 64-bit buffers");
+  }
+  RunEngine(input, sa, lcp, engine, times);
+}
+
+void CalculateSuffixArrayLCP(const Text& input, long long* sa, long long* lcp, LcpEngine engine, PhaseTimes* times) {
+  RunEngine(input, sa, lcp, engine, times);
+}
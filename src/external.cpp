@@ -0,0 +1,868 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <sys/types.h>
+using namespace std;
+
+#include "external.h"
+#include "lcp.h"
+
+/*
+ * Bytes of the buffers of the sequential reads and writes, at most, and
+ * bytes of lookahead every scanned position of the text gets, its key.
+ */
+const size_t kStreamBlock = 1 << 16;
+const size_t kWindow = 8;
+
+/*
+ * Returns true for the bytes that end the text of a file.
+ */
+inline bool EndsText(unsigned char c) {
+  return c == 0 || c == kSentinel || c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+/*
+ * Reads the text of the file sequentially, 'block' bytes at a time, and
+ * calls body(i, p) for every position i, in order, where p points at the
+ * text from position i on, with kWindow readable bytes that are 0 past the
+ * end of the text. Sets the text length. Returns false if the file can't
+ * be read.
+ */
+template<class Body>
+bool ScanText(const char *filename, size_t block, size_t& length, ExternalStats& stats, Body body) {
+  FILE *file = fopen(filename, "rb");
+  if (file == NULL) {
+    return false;
+  }
+  stats.scans++;
+
+  vector<unsigned char> buffer(block + kWindow);
+  size_t filled = 0;
+  bool ended = false;
+  length = 0;
+  while (true) {
+    // fill the buffer, up to the end of the text
+    while (!ended && filled < buffer.size()) {
+      size_t read = fread(&buffer[filled], 1, buffer.size() - filled, file);
+      stats.text_read += read;
+      if (read == 0) {
+        ended = true;
+      }
+      for (size_t k = filled; k < filled + read; k++) {
+        if (EndsText(buffer[k])) {
+          ended = true;
+          read = k - filled;
+          break;
+        }
+      }
+      filled += read;
+    }
+    fill(buffer.begin() + filled, buffer.end(), 0);
+
+    const size_t count = min(filled, block);
+    for (size_t k = 0; k < count; k++) {
+      body(length + k, &buffer[k]);
+    }
+    length += count;
+    if (ended && filled == count) {
+      break;
+    }
+    memmove(&buffer[0], &buffer[count], filled - count);
+    filled -= count;
+  }
+
+  bool ok = !ferror(file);
+  fclose(file);
+  return ok;
+}
+
+/*
+ * Returns the code of a byte of the text in the order of the suffixes:
+ * bytes compare as signed chars, as in the in-memory engines, and all come
+ * after 0, which never occurs in the text and stands for its end.
+ */
+inline unsigned long long CharCode(unsigned char c) {
+  const int value = (signed char)c;
+  if (c == 0) {
+    return 0;
+  }
+  return value < 0 ? value + 129 : value + 128;
+}
+
+/*
+ * Returns the key of the suffix at p: the codes of its first 8 characters,
+ * big-endian, so keys compare like the prefixes.
+ */
+inline unsigned long long Key(const unsigned char *p) {
+  unsigned long long key = 0;
+  for (size_t k = 0; k < 8; k++) {
+    key = (key << 8) | CharCode(p[k]);
+  }
+  return key;
+}
+
+/*
+ * Returns the number of leading characters two keys share.
+ */
+inline size_t KeyLcp(unsigned long long x, unsigned long long y) {
+  return x == y ? 8 : __builtin_clzll(x ^ y) / 8;
+}
+
+/*
+ * Record of the external sorts, ordered by its key, with a value carried
+ * along.
+ */
+template<class Key, class Value>
+struct Entry {
+  Key key;
+  Value value;
+
+  bool operator<(const Entry& other) const {
+    return key < other.key;
+  }
+};
+
+/*
+ * Suffix at 'position' in a doubling round, ordered by the names of its
+ * prefix of the round's length and of the prefix as long right after it,
+ * 0 past the end of the text.
+ */
+template<class Index>
+struct Tuple {
+  Index first;
+  Index second;
+  Index position;
+
+  bool operator<(const Tuple& other) const {
+    return first != other.first ? first < other.first : second < other.second;
+  }
+};
+
+/*
+ * Temporary file, removed when closed or destroyed.
+ */
+class TemporaryFile {
+  public:
+  string name;
+  FILE *file;
+
+  TemporaryFile() {
+    file = NULL;
+  }
+
+  ~TemporaryFile() {
+    Close();
+  }
+
+/*
+ * Creates the file empty, replacing the one open before. Returns false if
+ * it can't be created.
+ */
+  bool Create(const string& name_) {
+    Close();
+    name = name_;
+    file = fopen(name.c_str(), "w+b");
+    return file != NULL;
+  }
+
+/*
+ * Closes and removes the file.
+ */
+  void Close() {
+    if (file != NULL) {
+      fclose(file);
+      remove(name.c_str());
+      file = NULL;
+    }
+  }
+
+/*
+ * Swaps the files of two temporaries.
+ */
+  void Swap(TemporaryFile& other) {
+    name.swap(other.name);
+    swap(file, other.file);
+  }
+
+  private:
+  TemporaryFile(const TemporaryFile&);
+  TemporaryFile& operator=(const TemporaryFile&);
+};
+
+/*
+ * Returns the number of records of a buffer of 'bytes' bytes, at least one.
+ */
+template<class Record>
+size_t BlockRecords(size_t bytes) {
+  return max((size_t)1, bytes / sizeof(Record));
+}
+
+/*
+ * Buffered writer of records to the end of a temporary file.
+ */
+template<class Record>
+class RecordWriter {
+  public:
+  FILE *file;
+  vector<Record> buffer;
+  size_t used;
+  bool failed;
+  unsigned long long *written;
+
+  RecordWriter(FILE *file_, size_t block, unsigned long long& written_) {
+    file = file_;
+    buffer.resize(BlockRecords<Record>(block));
+    used = 0;
+    failed = file == NULL;
+    written = &written_;
+  }
+
+/*
+ * Appends the record.
+ */
+  void Put(const Record& record) {
+    buffer[used++] = record;
+    if (used == buffer.size()) {
+      Flush();
+    }
+  }
+
+/*
+ * Writes the buffered records. Returns false if any write failed.
+ */
+  bool Flush() {
+    if (used > 0 && !failed && fwrite(&buffer[0], sizeof(Record), used, file) != used) {
+      failed = true;
+    }
+    *written += used * sizeof(Record);
+    used = 0;
+    return !failed;
+  }
+};
+
+/*
+ * Buffered reader of 'count' records of a temporary file, from record
+ * 'offset' on. Readers can share a file, as they seek before every read.
+ */
+template<class Record>
+class RecordReader {
+  public:
+  FILE *file;
+  size_t next;
+  size_t end;
+  vector<Record> buffer;
+  size_t buffered;
+  size_t used;
+  bool failed;
+  unsigned long long *read;
+
+  RecordReader(FILE *file_, size_t offset, size_t count, size_t records, unsigned long long& read_) {
+    file = file_;
+    next = offset;
+    end = offset + count;
+    buffer.resize(max((size_t)1, min(records, count)));
+    buffered = used = 0;
+    failed = file == NULL;
+    read = &read_;
+  }
+
+/*
+ * Reads the next record. Returns false at the end, or if a read failed.
+ */
+  bool Next(Record& record) {
+    if (used == buffered && !Fill()) {
+      return false;
+    }
+    record = buffer[used++];
+    return true;
+  }
+
+/*
+ * Reads the next records into the buffer.
+ */
+  bool Fill() {
+    if (next == end || failed) {
+      return false;
+    }
+    const size_t count = min(buffer.size(), end - next);
+    if (fseeko(file, (off_t)next * sizeof(Record), SEEK_SET) != 0 ||
+        fread(&buffer[0], sizeof(Record), count, file) != count) {
+      failed = true;
+      return false;
+    }
+    *read += count * sizeof(Record);
+    next += count;
+    buffered = count;
+    used = 0;
+    return true;
+  }
+};
+
+/*
+ * Sorted run of an external sort in its temporary file, in records.
+ */
+struct Run {
+  size_t offset;
+  size_t length;
+};
+
+/*
+ * Sorts more records than fit into memory. Added records are collected
+ * into a buffer of 'memory' bytes, which is sorted and appended to a
+ * temporary file as a run whenever it fills up. Runs are then merged, as
+ * many at once as the buffer holds blocks, into longer runs in a second
+ * file until a single merge is left, whose records are read one by one.
+ * Records that fit into the buffer are sorted in memory.
+ */
+template<class Record>
+class ExternalSorter {
+  public:
+  ExternalSorter(const string& name_, size_t memory, size_t block_, size_t expected, ExternalStats& stats_)
+      : name(name_), stats(stats_) {
+    capacity = max((size_t)2, memory / sizeof(Record));
+    block = block_;
+    buffer.reserve(min(capacity, expected));
+    position = 0;
+    merging = false;
+    failed = false;
+  }
+
+/*
+ * Adds a record.
+ */
+  void Add(const Record& record) {
+    buffer.push_back(record);
+    if (buffer.size() == capacity) {
+      SpillRun();
+    }
+  }
+
+/*
+ * Sorts the added records, so they can be read. Returns false if a
+ * temporary file couldn't be written.
+ */
+  bool Sort() {
+    if (runs.empty()) {
+      sort(buffer.begin(), buffer.end());
+      return !failed;
+    }
+    if (!buffer.empty()) {
+      SpillRun();
+    }
+    vector<Record>().swap(buffer);
+
+    const size_t fan_in = max((size_t)2, capacity / BlockRecords<Record>(block));
+    while (!failed && runs.size() > fan_in) {
+      // the passes alternate between the two files
+      const string merged_name = runs_file.name == name + ".runs" ? name + ".merged" : name + ".runs";
+      if (!merged_file.Create(merged_name)) {
+        failed = true;
+        break;
+      }
+      RecordWriter<Record> writer(merged_file.file, block, stats.temp_written);
+      vector<Run> merged;
+      size_t written = 0;
+      for (size_t first = 0; first < runs.size(); first += fan_in) {
+        StartMerge(first, min(fan_in, runs.size() - first));
+        Run run = {written, 0};
+        Record record;
+        while (NextMerged(record)) {
+          writer.Put(record);
+          run.length++;
+        }
+        written += run.length;
+        merged.push_back(run);
+      }
+      failed = failed || !writer.Flush();
+      runs.swap(merged);
+      runs_file.Swap(merged_file);
+    }
+    if (!failed) {
+      StartMerge(0, runs.size());
+      merging = true;
+    }
+    return !failed;
+  }
+
+/*
+ * Reads the next record in sorted order. Returns false after the last one,
+ * or if a temporary file couldn't be read.
+ */
+  bool Next(Record& record) {
+    if (merging) {
+      return NextMerged(record);
+    }
+    if (position == buffer.size()) {
+      return false;
+    }
+    record = buffer[position++];
+    return true;
+  }
+
+/*
+ * Returns true if a temporary file couldn't be written or read.
+ */
+  bool Failed() const {
+    return failed;
+  }
+
+  private:
+  typedef pair<Record, size_t> Head;
+
+/*
+ * Orders the heads of the merged runs smallest first.
+ */
+  struct Later {
+    bool operator()(const Head& x, const Head& y) const {
+      return y.first < x.first;
+    }
+  };
+
+  string name;
+  ExternalStats& stats;
+  size_t capacity;
+  size_t block;
+  vector<Record> buffer;
+  size_t position;
+  TemporaryFile runs_file;
+  TemporaryFile merged_file;
+  vector<Run> runs;
+  vector<RecordReader<Record> > readers;
+  priority_queue<Head, vector<Head>, Later> heads;
+  bool merging;
+  bool failed;
+
+/*
+ * Sorts the buffer and appends it to the runs file.
+ */
+  void SpillRun() {
+    if (runs_file.file == NULL && !runs_file.Create(name + ".runs")) {
+      failed = true;
+    }
+    sort(buffer.begin(), buffer.end());
+    Run run = {runs.empty() ? 0 : runs.back().offset + runs.back().length, buffer.size()};
+    runs.push_back(run);
+    stats.runs++;
+    stats.temp_written += buffer.size() * sizeof(Record);
+    if (!failed && fwrite(&buffer[0], sizeof(Record), buffer.size(), runs_file.file) != buffer.size()) {
+      failed = true;
+    }
+    buffer.clear();
+  }
+
+/*
+ * Starts merging 'count' runs of the runs file from run 'first' on, each
+ * read through an equal part of the buffer.
+ */
+  void StartMerge(size_t first, size_t count) {
+    readers.clear();
+    heads = priority_queue<Head, vector<Head>, Later>();
+    const size_t per_run = max((size_t)1, capacity / count);
+    for (size_t k = 0; k < count; k++) {
+      readers.push_back(RecordReader<Record>(runs_file.file, runs[first + k].offset, runs[first + k].length,
+          per_run, stats.temp_read));
+      Record record;
+      if (readers[k].Next(record)) {
+        heads.push(Head(record, k));
+      }
+      failed = failed || readers[k].failed;
+    }
+  }
+
+/*
+ * Reads the smallest head of the merged runs.
+ */
+  bool NextMerged(Record& record) {
+    if (heads.empty()) {
+      return false;
+    }
+    const size_t k = heads.top().second;
+    record = heads.top().first;
+    heads.pop();
+    Record next;
+    if (readers[k].Next(next)) {
+      heads.push(Head(next, k));
+    }
+    failed = failed || readers[k].failed;
+    return !failed;
+  }
+};
+
+/*
+ * External construction with Index as the type of positions and names.
+ * Suffixes are sorted by prefix doubling: the prefixes of 8 characters are
+ * named by the ranks of their keys, and every round names the prefixes
+ * twice as long by the ranks of the pairs of names at i and i + h, sorted
+ * externally and brought back into text order by a second sort. Every
+ * level of names is kept in a temporary file until all names differ, and
+ * the order of the last round is the suffix array.
+ *
+ * The LCP values of neighbouring suffixes then come from binary lifting.
+ * The last round starts them: two neighbours share the prefix of the last
+ * level if their first names are equal. From the level below down, an LCP
+ * grows by the prefix length of the level whenever the names at both
+ * suffixes, shifted by the LCP found so far, are equal, and the last
+ * characters come from the keys. The names of a level are looked up for all
+ * suffixes at once, by sorting the lookups by position, scanning the level
+ * and sorting the names back.
+ */
+template<class Index>
+class DoublingBuilder {
+  public:
+  const char *filename;
+  string prefix;
+  size_t memory;
+  size_t block;
+  ExternalStats& stats;
+  size_t n;
+  vector<unique_ptr<TemporaryFile> > levels;
+  TemporaryFile order;
+  TemporaryFile offsets;
+  TemporaryFile next_offsets;
+
+/*
+ * The temporary files are named from 'prefix_'. Two sorts run at once, and
+ * each gets a third of the budget, the rest is left for the I/O buffers.
+ */
+  DoublingBuilder(const char *filename_, const string& prefix_, size_t memory_budget, ExternalStats& stats_)
+      : filename(filename_), prefix(prefix_), stats(stats_) {
+    memory = memory_budget / 3;
+    block = max((size_t)64, min(kStreamBlock, memory_budget / 16));
+    n = 0;
+  }
+
+/*
+ * Names the prefixes of 8 characters of a text of about 'expected'
+ * characters. Sets 'done' if they all differ, and 'read' if the file could
+ * be read.
+ */
+  bool NameKeys(size_t expected, bool& done, bool& read) {
+    stats.rounds++;
+    ExternalSorter<Entry<unsigned long long, Index> > keys(prefix + ".keys", memory, block, expected, stats);
+    read = ScanText(filename, block, n, stats, [&](size_t i, const unsigned char *p) {
+      Entry<unsigned long long, Index> entry = {Key(p), (Index)i};
+      keys.Add(entry);
+    });
+    if (!read || !keys.Sort() || !order.Create(prefix + ".order") || !offsets.Create(prefix + ".lcp")) {
+      return false;
+    }
+
+    ExternalSorter<Entry<Index, Index> > names(prefix + ".names", memory, block, n, stats);
+    RecordWriter<Index> suffixes(order.file, block, stats.temp_written);
+    RecordWriter<Index> lcps(offsets.file, block, stats.temp_written);
+    Entry<unsigned long long, Index> entry;
+    unsigned long long previous = 0;
+    Index name = 0;
+    while (keys.Next(entry)) {
+      if (name > 0) {
+        lcps.Put((Index)KeyLcp(previous, entry.key));
+      }
+      if (name == 0 || entry.key != previous) {
+        name++;
+      }
+      previous = entry.key;
+      Entry<Index, Index> named = {entry.value, name};
+      names.Add(named);
+      suffixes.Put(entry.value);
+    }
+    return !keys.Failed() && suffixes.Flush() && lcps.Flush() && AddLevel(names, name, done);
+  }
+
+/*
+ * Names the prefixes twice as long as those of the last level, and starts
+ * the LCP values of the new order at the prefix length of the last level
+ * where the first names are equal. Sets 'done' if they all differ.
+ */
+  bool Double(bool& done) {
+    stats.rounds++;
+    const size_t h = (size_t)8 << (levels.size() - 1);
+    FILE *level = levels.back()->file;
+    RecordReader<Index> firsts(level, 0, n, BlockRecords<Index>(block), stats.temp_read);
+    RecordReader<Index> seconds(level, min(h, n), n - min(h, n), BlockRecords<Index>(block), stats.temp_read);
+    ExternalSorter<Tuple<Index> > tuples(prefix + ".tuples", memory, block, n, stats);
+    for (size_t i = 0; i < n; i++) {
+      Tuple<Index> tuple = {0, 0, (Index)i};
+      firsts.Next(tuple.first);
+      if (i + h < n) {
+        seconds.Next(tuple.second);
+      }
+      tuples.Add(tuple);
+    }
+    if (firsts.failed || seconds.failed || !tuples.Sort() || !order.Create(prefix + ".order") ||
+        !offsets.Create(prefix + ".lcp")) {
+      return false;
+    }
+
+    ExternalSorter<Entry<Index, Index> > names(prefix + ".names", memory, block, n, stats);
+    RecordWriter<Index> suffixes(order.file, block, stats.temp_written);
+    RecordWriter<Index> lcps(offsets.file, block, stats.temp_written);
+    Tuple<Index> tuple, previous = {0, 0, 0};
+    Index name = 0;
+    while (tuples.Next(tuple)) {
+      if (name > 0) {
+        lcps.Put(previous.first == tuple.first ? (Index)h : 0);
+      }
+      if (name == 0 || previous < tuple) {
+        name++;
+      }
+      previous = tuple;
+      Entry<Index, Index> named = {tuple.position, name};
+      names.Add(named);
+      suffixes.Put(tuple.position);
+    }
+    return !tuples.Failed() && suffixes.Flush() && lcps.Flush() && AddLevel(names, name, done);
+  }
+
+/*
+ * Writes the names, given in suffix order, in text order as the next
+ * level, unless all 'distinct' names differ, which sets 'done'.
+ */
+  bool AddLevel(ExternalSorter<Entry<Index, Index> >& names, Index distinct, bool& done) {
+    done = (size_t)distinct == n;
+    if (done) {
+      return true;
+    }
+    levels.push_back(unique_ptr<TemporaryFile>(new TemporaryFile()));
+    if (!levels.back()->Create(prefix + ".level" + to_string(levels.size())) || !names.Sort()) {
+      return false;
+    }
+    RecordWriter<Index> writer(levels.back()->file, block, stats.temp_written);
+    Entry<Index, Index> entry;
+    while (names.Next(entry)) {
+      writer.Put(entry.value);
+    }
+    return !names.Failed() && writer.Flush();
+  }
+
+/*
+ * Queues the lookups at both suffixes of every neighbouring pair, shifted
+ * by the LCP found so far, for the pairs where both shifted suffixes are
+ * at least 'length' characters long, keyed by the position.
+ */
+  template<class Lookups>
+  bool AddLookups(Lookups& lookups, size_t length) {
+    RecordReader<Index> suffixes(order.file, 0, n, BlockRecords<Index>(block), stats.temp_read);
+    RecordReader<Index> lcps(offsets.file, 0, n - 1, BlockRecords<Index>(block), stats.temp_read);
+    Index previous = 0, current = 0, lcp = 0;
+    suffixes.Next(previous);
+    for (size_t pair = 1; pair < n; pair++) {
+      suffixes.Next(current);
+      lcps.Next(lcp);
+      if ((size_t)previous + lcp + length <= n && (size_t)current + lcp + length <= n) {
+        Entry<Index, Index> first = {(Index)(previous + lcp), (Index)pair};
+        Entry<Index, Index> second = {(Index)(current + lcp), (Index)pair};
+        lookups.Add(first);
+        lookups.Add(second);
+      }
+      previous = current;
+    }
+    return !suffixes.failed && !lcps.failed && lookups.Sort();
+  }
+
+/*
+ * Lifts the LCP values of all neighbouring pairs by the prefix length of
+ * the level, where the names of both shifted suffixes are equal.
+ */
+  bool Lift(size_t level) {
+    const size_t h = (size_t)8 << level;
+    ExternalSorter<Entry<Index, Index> > lookups(prefix + ".lookups", memory, block, 2 * n, stats);
+    if (!AddLookups(lookups, h)) {
+      return false;
+    }
+
+    ExternalSorter<Entry<Index, Index> > names(prefix + ".names", memory, block, 2 * n, stats);
+    RecordReader<Index> level_names(levels[level]->file, 0, n, BlockRecords<Index>(block), stats.temp_read);
+    Entry<Index, Index> lookup;
+    Index name = 0;
+    size_t at = 0;
+    while (lookups.Next(lookup)) {
+      for (; at <= (size_t)lookup.key; at++) {
+        level_names.Next(name);
+      }
+      Entry<Index, Index> named = {lookup.value, name};
+      names.Add(named);
+    }
+    if (lookups.Failed() || level_names.failed || !names.Sort()) {
+      return false;
+    }
+    levels[level].reset();
+
+    if (!next_offsets.Create(prefix + ".lcp" + to_string(level))) {
+      return false;
+    }
+    RecordReader<Index> lcps(offsets.file, 0, n - 1, BlockRecords<Index>(block), stats.temp_read);
+    RecordWriter<Index> lifted(next_offsets.file, block, stats.temp_written);
+    Entry<Index, Index> first, second;
+    bool more = names.Next(first);
+    for (size_t pair = 1; pair < n; pair++) {
+      Index lcp = 0;
+      lcps.Next(lcp);
+      if (more && (size_t)first.key == pair) {
+        names.Next(second);
+        if (first.value == second.value) {
+          lcp += h;
+        }
+        more = names.Next(first);
+      }
+      lifted.Put(lcp);
+    }
+    if (names.Failed() || lcps.failed || !lifted.Flush()) {
+      return false;
+    }
+    offsets.Swap(next_offsets);
+    next_offsets.Close();
+    return true;
+  }
+
+/*
+ * Finds the LCP values of all neighbouring suffixes, and streams the
+ * suffix array and the LCP array, the sentinel first, to the writers.
+ * Returns false if a file can't be read or written, and sets 'read' if
+ * the input was read.
+ */
+  bool WriteArrays(ValueWriter& sa, ValueWriter& lcp, bool& read) {
+    read = true;
+    sa.Put(n);
+    lcp.Put(0);
+    if (n == 0) {
+      return true;
+    }
+
+    // the last round already compared the names of the top level
+    if (!levels.empty()) {
+      levels.back().reset();
+    }
+    for (size_t level = levels.size(); level-- > 1; ) {
+      if (!Lift(level - 1)) {
+        return false;
+      }
+    }
+
+    // the last characters of the LCP values are compared by the keys
+    ExternalSorter<Entry<Index, Index> > lookups(prefix + ".lookups", memory, block, 2 * n, stats);
+    if (!AddLookups(lookups, 1)) {
+      return false;
+    }
+    ExternalSorter<Entry<Index, unsigned long long> > keys(prefix + ".keys", memory, block, 2 * n, stats);
+    Entry<Index, Index> lookup;
+    bool more = lookups.Next(lookup);
+    size_t length;
+    read = ScanText(filename, block, length, stats, [&](size_t i, const unsigned char *p) {
+      for (; more && (size_t)lookup.key == i; more = lookups.Next(lookup)) {
+        Entry<Index, unsigned long long> key = {lookup.value, Key(p)};
+        keys.Add(key);
+      }
+    });
+    if (!read || length != n || lookups.Failed() || !keys.Sort()) {
+      return false;
+    }
+
+    RecordReader<Index> suffixes(order.file, 0, n, BlockRecords<Index>(block), stats.temp_read);
+    RecordReader<Index> lcps(offsets.file, 0, n - 1, BlockRecords<Index>(block), stats.temp_read);
+    Index suffix = 0;
+    suffixes.Next(suffix);
+    sa.Put(suffix);
+    lcp.Put(0);
+    Entry<Index, unsigned long long> first, second;
+    more = keys.Next(first);
+    for (size_t pair = 1; pair < n; pair++) {
+      Index value = 0;
+      suffixes.Next(suffix);
+      lcps.Next(value);
+      if (more && (size_t)first.key == pair) {
+        keys.Next(second);
+        value += KeyLcp(first.value, second.value);
+        more = keys.Next(first);
+      }
+      sa.Put(suffix);
+      lcp.Put(value);
+    }
+    return !keys.Failed() && !suffixes.failed && !lcps.failed;
+  }
+};
+
+/*
+ * ExternalSuffixArrayLCP with Index as the type of positions and names.
+ */
+template<class Index>
+bool ExternalSuffixArrayLCPAs(const char *filename, const Options& options, size_t memory_budget,
+    size_t file_size, const string& sa_filename, const string& lcp_filename, ExternalStats& stats, string& error) {
+  const string prefix = lcp_filename + ".tmp";
+  DoublingBuilder<Index> builder(filename, prefix, memory_budget, stats);
+  bool done = false;
+  bool read = true;
+  bool ok = builder.NameKeys(file_size, done, read);
+  while (ok && !done) {
+    ok = builder.Double(done);
+  }
+  if (!read) {
+    error = "could not read the file";
+    return false;
+  }
+  if (!ok) {
+    error = "could not sort the suffixes through " + prefix + ".*";
+    return false;
+  }
+
+  const size_t n = builder.n;
+  ValueWriter sa;
+  ValueWriter lcp;
+  if (!sa.Open(sa_filename.c_str(), options.format, n + 1)) {
+    error = "could not write " + sa_filename;
+    return false;
+  }
+  if (!lcp.Open(lcp_filename.c_str(), options.format, n + 1)) {
+    error = "could not write " + lcp_filename;
+    return false;
+  }
+  if (!builder.WriteArrays(sa, lcp, read)) {
+    error = read ? "could not find the LCP values through " + prefix + ".*" : "could not read the file";
+    return false;
+  }
+
+  bool sa_ok = sa.Close();
+  bool lcp_ok = lcp.Close();
+  stats.output_written = sa.Bytes() + lcp.Bytes();
+  if (!sa_ok || !lcp_ok) {
+    error = "could not write " + (sa_ok ? lcp_filename : sa_filename);
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Builds the suffix array and the LCP array of the input file within about
+ * 'memory_budget' bytes of RAM and streams both to the files. See
+ * external.h.
+ */
+bool ExternalSuffixArrayLCP(const char *filename, const Options& options, size_t memory_budget,
+    const string& sa_filename, const string& lcp_filename, ExternalStats& stats, string& error) {
+  // the text is at most the file, so its size picks the width of the
+  // temporary records
+  struct stat st;
+  if (stat(filename, &st) != 0) {
+    error = "could not read the file";
+    return false;
+  }
+  if ((long long)st.st_size < kMaxInt32Length) {
+    return ExternalSuffixArrayLCPAs<int>(filename, options, memory_budget, st.st_size, sa_filename, lcp_filename,
+        stats, error);
+  }
+  return ExternalSuffixArrayLCPAs<long long>(filename, options, memory_budget, st.st_size, sa_filename, lcp_filename,
+      stats, error);
+}
+
+/*
+ * Prints the I/O volume of an external construction.
+ */
+void PrintExternalStats(const ExternalStats& stats) {
+  printf("Rounds: %d, runs: %d, scans: %d\n", stats.rounds, stats.runs, stats.scans);
+  printf("Read: %.1f MB of text, %.1f MB of temporary files\n", stats.text_read / 1e6, stats.temp_read / 1e6);
+  printf("Written: %.1f MB of temporary files, %.1f MB of output\n", stats.temp_written / 1e6,
+      stats.output_written / 1e6);
+}
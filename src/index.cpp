@@ -0,0 +1,312 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "index.h"
+
+/*
+ * Alignment of the sections, and bytes of the text written at once.
+ */
+const uint64_t kSectionAlignment = 64;
+const size_t kTextChunk = 1 << 20;
+
+/*
+ * 64-bit checksum of the bytes, continuing from the previous one. Four
+ * independent lanes take 8 bytes each per round, so the multiplies
+ * overlap; this runs at several GB/s, and catches corrupt or truncated
+ * sections, not deliberate changes. The text is summed in chunks of
+ * kTextChunk bytes, each continuing from the checksum of the previous one.
+ */
+uint64_t Checksum(const void *data, size_t bytes, uint64_t previous) {
+  const uint64_t kMultiplier = 0x9E3779B97F4A7C15ULL;
+  const unsigned char *p = (const unsigned char *)data;
+  uint64_t lanes[4] = {previous, previous ^ 1, previous ^ 2, previous ^ 3};
+  size_t i = 0;
+  for (; i + 32 <= bytes; i += 32) {
+    for (int l = 0; l < 4; l++) {
+      uint64_t word;
+      memcpy(&word, p + i + 8 * l, 8);
+      lanes[l] = (lanes[l] ^ word) * kMultiplier;
+      lanes[l] ^= lanes[l] >> 29;
+    }
+  }
+  uint64_t hash = bytes;
+  for (int l = 0; l < 4; l++) {
+    hash = (hash ^ lanes[l]) * kMultiplier;
+  }
+  for (; i < bytes; i++) {
+    hash = (hash ^ p[i]) * kMultiplier;
+  }
+  return hash ^ (hash >> 32);
+}
+
+/*
+ * Rounds the offset up to the section alignment.
+ */
+inline uint64_t Align(uint64_t offset) {
+  return (offset + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+}
+
+/*
+ * Calls the visitor with the text in chunks of kTextChunk bytes, in place
+ * for byte texts and decoded for packed ones.
+ */
+template<class Visitor>
+void VisitText(const Text& input, Visitor& visitor) {
+  const bool in_place = input.packed == NULL && input.stored == input.size;
+  vector<char> chunk;
+  for (size_t start = 0; start < input.length(); start += kTextChunk) {
+    const size_t end = min(input.length(), start + kTextChunk);
+    if (in_place) {
+      visitor(input.data + start, end - start);
+      continue;
+    }
+    chunk.resize(end - start);
+    for (size_t i = start; i < end; i++) {
+      chunk[i - start] = input[i];
+    }
+    visitor(&chunk[0], chunk.size());
+  }
+}
+
+/*
+ * Checksum of the text, chunk by chunk.
+ */
+struct TextChecksum {
+  uint64_t checksum;
+
+  TextChecksum() : checksum(0) {}
+
+  void operator()(const char *data, size_t bytes) {
+    checksum = Checksum(data, bytes, checksum);
+  }
+};
+
+/*
+ * Writes the text to the file, chunk by chunk.
+ */
+struct TextWriter {
+  FILE *file;
+  bool failed;
+
+  TextWriter(FILE *file_) : file(file_), failed(false) {}
+
+  void operator()(const char *data, size_t bytes) {
+    failed = failed || fwrite(data, 1, bytes, file) != bytes;
+  }
+};
+
+/*
+ * Returns the checksum of the header, with header_checksum as 0.
+ */
+uint64_t HeaderChecksum(IndexHeader header) {
+  header.header_checksum = 0;
+  return Checksum(&header, sizeof(header), 0);
+}
+
+/*
+ * Checks everything of the header that doesn't need the sections, against
+ * the size of the file. Returns false and sets the error if it can't be
+ * used.
+ */
+bool CheckHeader(const IndexHeader& header, size_t file_bytes, string& error) {
+  if (memcmp(header.magic, kIndexMagic, sizeof(kIndexMagic)) != 0) {
+    error = "not an index file";
+    return false;
+  }
+  if (header.byte_order != kIndexByteOrder) {
+    error = "index file of another byte order";
+    return false;
+  }
+  if (header.version != kIndexVersion) {
+    error = "index file version " + to_string(header.version) + ", expected " + to_string(kIndexVersion);
+    return false;
+  }
+  if (header.header_bytes != sizeof(IndexHeader) || HeaderChecksum(header) != header.header_checksum) {
+    error = "corrupt index header";
+    return false;
+  }
+  const uint64_t n = header.length;
+  const uint64_t width = header.index_bytes;
+  if ((width != 4 && width != 8) || header.file_bytes != file_bytes || n == 0 ||
+      header.text_offset < sizeof(IndexHeader) || header.sa_offset < header.text_offset + n ||
+      header.lcp_offset < header.sa_offset + n * width || header.buckets_offset < header.lcp_offset + n * width ||
+      header.buckets_offset + 512 * sizeof(uint64_t) > file_bytes ||
+      (header.sa_offset | header.lcp_offset | header.buckets_offset) % kSectionAlignment != 0) {
+    error = "truncated or inconsistent index file";
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Returns true if the file holds an index, of this version, of a text with
+ * the length and checksum.
+ */
+bool IsIndexOf(const string& filename, uint64_t length, uint64_t text_checksum) {
+  FILE *file = fopen(filename.c_str(), "rb");
+  if (file == NULL) {
+    return false;
+  }
+  IndexHeader header;
+  bool read = fread(&header, sizeof(header), 1, file) == 1;
+  bool seeked = fseek(file, 0, SEEK_END) == 0;
+  long file_bytes = ftell(file);
+  fclose(file);
+  string error;
+  return read && seeked && file_bytes > 0 && CheckHeader(header, file_bytes, error) && header.length == length &&
+      header.text_checksum == text_checksum;
+}
+
+/*
+ * Writes zeros up to the offset.
+ */
+bool PadTo(FILE *file, uint64_t offset) {
+  static const char zeros[kSectionAlignment] = {0};
+  const long at = ftell(file);
+  return at >= 0 && (uint64_t)at <= offset && fwrite(zeros, 1, offset - at, file) == offset - at;
+}
+
+/*
+ * BuildIndex with Value as the type of the arrays.
+ */
+template<class Value>
+bool BuildIndexAs(const Text& input, LcpEngine engine, const string& filename, uint64_t text_checksum,
+    string& error) {
+  const size_t n = input.length();
+  vector<Value> sa(n), lcp(n);
+  CalculateSuffixArrayLCP(input, &sa[0], &lcp[0], engine);
+
+  // bucket boundaries, in the signed character order of the suffix array,
+  // after the sentinel suffix, which is in no bucket
+  vector<uint64_t> buckets(512, 0);
+  vector<uint64_t> counts(256, 0);
+  for (size_t i = 0; i + 1 < n; i++) {
+    counts[(unsigned char)input[i]]++;
+  }
+  uint64_t begin = n > 0 ? 1 : 0;
+  for (int c = -128; c < 128; c++) {
+    const unsigned char letter = (unsigned char)c;
+    buckets[letter] = begin;
+    begin += counts[letter];
+    buckets[256 + letter] = begin;
+  }
+
+  IndexHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+  header.version = kIndexVersion;
+  header.byte_order = kIndexByteOrder;
+  header.header_bytes = sizeof(IndexHeader);
+  header.index_bytes = sizeof(Value);
+  header.length = n;
+  header.text_offset = Align(sizeof(IndexHeader));
+  header.sa_offset = Align(header.text_offset + n);
+  header.lcp_offset = Align(header.sa_offset + n * sizeof(Value));
+  header.buckets_offset = Align(header.lcp_offset + n * sizeof(Value));
+  header.file_bytes = header.buckets_offset + buckets.size() * sizeof(uint64_t);
+  header.text_checksum = text_checksum;
+  uint64_t data_checksum = Checksum(&sa[0], n * sizeof(Value), 0);
+  data_checksum = Checksum(&lcp[0], n * sizeof(Value), data_checksum);
+  header.data_checksum = Checksum(&buckets[0], buckets.size() * sizeof(uint64_t), data_checksum);
+  header.header_checksum = HeaderChecksum(header);
+
+  const string temporary = filename + ".tmp";
+  FILE *file = fopen(temporary.c_str(), "wb");
+  if (file == NULL) {
+    error = "could not create " + temporary;
+    return false;
+  }
+  TextWriter writer(file);
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1 && PadTo(file, header.text_offset);
+  if (written) {
+    VisitText(input, writer);
+  }
+  written = written && !writer.failed &&
+      PadTo(file, header.sa_offset) && fwrite(&sa[0], sizeof(Value), n, file) == n &&
+      PadTo(file, header.lcp_offset) && fwrite(&lcp[0], sizeof(Value), n, file) == n &&
+      PadTo(file, header.buckets_offset) && fwrite(&buckets[0], sizeof(uint64_t), buckets.size(), file) == buckets.size();
+  written = fclose(file) == 0 && written;
+  if (!written || rename(temporary.c_str(), filename.c_str()) != 0) {
+    remove(temporary.c_str());
+    error = "could not write " + filename;
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Builds the suffix array and LCP array of the input with the engine, and
+ * writes them with the text into an index file, unless the file already
+ * holds a compatible index of the same text (same length and checksum).
+ * Arrays are 32-bit if the input is short enough, and 64-bit otherwise.
+ */
+bool BuildIndex(const Text& input, LcpEngine engine, const string& filename, bool& reused, string& error) {
+  reused = false;
+  if (input.length() == 0) {
+    error = "empty input";
+    return false;
+  }
+  TextChecksum text_checksum;
+  VisitText(input, text_checksum);
+  if (IsIndexOf(filename, input.length(), text_checksum.checksum)) {
+    reused = true;
+    return true;
+  }
+  if ((long long)input.length() <= kMaxInt32Length) {
+    return BuildIndexAs<int>(input, engine, filename, text_checksum.checksum, error);
+  }
+  return BuildIndexAs<long long>(input, engine, filename, text_checksum.checksum, error);
+}
+
+LcpIndex::LcpIndex() {
+  memset(&header, 0, sizeof(header));
+}
+
+/*
+ * Maps the index file and checks its header, without touching the
+ * sections, so opening takes the same time for any size.
+ */
+bool LcpIndex::Open(const char *filename, string& error) {
+  Close();
+  if (!file.Open(filename)) {
+    error = string("could not open ") + filename;
+    return false;
+  }
+  if (file.size < sizeof(IndexHeader)) {
+    error = "not an index file";
+    Close();
+    return false;
+  }
+  memcpy(&header, file.data, sizeof(header));
+  if (!CheckHeader(header, file.size, error)) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+bool LcpIndex::VerifyChecksums(string& error) const {
+  TextChecksum text_checksum;
+  VisitText(text(), text_checksum);
+  if (text_checksum.checksum != header.text_checksum) {
+    error = "text checksum mismatch";
+    return false;
+  }
+  const size_t array_bytes = header.length * header.index_bytes;
+  uint64_t checksum = Checksum(file.data + header.sa_offset, array_bytes, 0);
+  checksum = Checksum(file.data + header.lcp_offset, array_bytes, checksum);
+  checksum = Checksum(file.data + header.buckets_offset, 512 * sizeof(uint64_t), checksum);
+  if (checksum != header.data_checksum) {
+    error = "suffix array, LCP array or bucket checksum mismatch";
+    return false;
+  }
+  return true;
+}
+
+void LcpIndex::Close() {
+  file.Close();
+  memset(&header, 0, sizeof(header));
+}
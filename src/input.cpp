@@ -0,0 +1,223 @@
+#include <cstdio>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+#include "input.h"
+
+/*
+ * Reads the input file up to the first whitespace, which is how the test
+ * inputs are stored. Returns false if the file can't be opened.
+ */
+bool ReadInput(const char *filename, string& text) {
+  ifstream file (filename, ifstream::in);
+  if (!file.good()) {
+    return false;
+  }
+
+  file >> text;
+  file.close();
+  return true;
+}
+
+MappedFile::MappedFile() {
+  data = NULL;
+  size = 0;
+  mapped_size = 0;
+}
+
+MappedFile::~MappedFile() {
+  Close();
+}
+
+/*
+ * Maps the file, returns false if it can't be opened or mapped.
+ * An anonymous mapping one byte larger than the file is reserved first and
+ * the file is mapped over it, so the byte after the end of the file is
+ * always addressable, even when the file size is a multiple of page size.
+ */
+bool MappedFile::Open(const char *filename) {
+  Close();
+
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t file_size = st.st_size;
+  size_t total = (file_size + 1 + page - 1) / page * page;
+
+  void *base = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+
+  if (file_size > 0) {
+    void *mapped = mmap(base, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    if (mapped == MAP_FAILED) {
+      munmap(base, total);
+      close(fd);
+      return false;
+    }
+    madvise(base, file_size, MADV_WILLNEED);
+  }
+  close(fd);
+
+  data = (char *)base;
+  size = file_size;
+  mapped_size = total;
+  return true;
+}
+
+/*
+ * Unmaps the file.
+ */
+void MappedFile::Close() {
+  if (data != NULL) {
+    munmap(data, mapped_size);
+  }
+  data = NULL;
+  size = 0;
+  mapped_size = 0;
+}
+
+/*
+ * Returns true for the end of line characters.
+ */
+inline bool IsNewline(char c) {
+  return c == '\n' || c == '\r';
+}
+
+/*
+ * Prepares the mapped bytes of a file as the input text, in place. Newlines
+ * are either dropped or turned into separators. The text ends at the first
+ * sentinel (anything after it, like the description line of the test
+ * inputs, is ignored), or the sentinel is added at the end of the file.
+ * Bytes are only written when they move, so pages before the first newline
+ * stay shared with the page cache.
+ */
+Text MappedText(MappedFile& file, NewlineMode mode) {
+  char *data = file.data;
+  size_t length = 0;
+
+  for (size_t i = 0; i < file.size; i++) {
+    char c = data[i];
+    if (c == kSentinel) {
+      break;
+    }
+    if (IsNewline(c)) {
+      if (mode == kFilterNewlines || length == 0 || data[length-1] == kSeparator) {
+        continue;
+      }
+      c = kSeparator;
+    }
+    if (length != i || c != data[i]) {
+      data[length] = c;
+    }
+    length++;
+  }
+
+  // the text can't end with a separator
+  while (length > 0 && data[length-1] == kSeparator) {
+    length--;
+  }
+  data[length++] = kSentinel;
+
+  return Text(data, length);
+}
+
+/*
+ * Parses the mapped FASTA or FASTQ file, in place, into one text made of
+ * the sequences of all records, separated by separators and ended by the
+ * sentinel. Records are returned in file order. Throws on malformed input.
+ * The text is never longer than the bytes already read, so it is written
+ * over the file contents from the front.
+ */
+Text MappedRecords(MappedFile& file, vector<Record>& records) {
+  char *data = file.data;
+  const size_t size = file.size;
+  size_t read = 0;
+  size_t length = 0;
+  records.clear();
+
+  while (read < size) {
+    char marker = data[read];
+    if (IsNewline(marker) || marker == ' ' || marker == '\t') {
+      read++;
+      continue;
+    }
+    if (marker != '>' && marker != '@') {
+      throw string("MappedRecords: expected '>' or '@' at the start of a record");
+    }
+    bool fastq = marker == '@';
+
+    // header line, the name is its first word
+    Record record;
+    size_t name_end = ++read;
+    while (name_end < size && !IsNewline(data[name_end]) && data[name_end] != ' ' && data[name_end] != '\t') {
+      name_end++;
+    }
+    record.name = string(data + read, name_end - read);
+    read = name_end;
+    while (read < size && !IsNewline(data[read])) {
+      read++;
+    }
+
+    if (!records.empty()) {
+      data[length++] = kSeparator;
+    }
+    record.start = length;
+
+    // sequence lines, up to the next record (FASTA) or the '+' line (FASTQ)
+    const char end_marker = fastq ? '+' : '>';
+    bool line_start = true;
+    while (read < size && !(line_start && data[read] == end_marker)) {
+      char c = data[read++];
+      line_start = IsNewline(c);
+      if (line_start || c == ' ' || c == '\t') {
+        continue;
+      }
+      if (length != read - 1 || c != data[length]) {
+        data[length] = c;
+      }
+      length++;
+    }
+    record.length = length - record.start;
+
+    if (fastq) {
+      if (read >= size) {
+        throw string("MappedRecords: FASTQ record " + record.name + " has no quality line");
+      }
+      while (read < size && !IsNewline(data[read])) {
+        read++;
+      }
+      // quality may be wrapped as well, and may start with '@' or '+'
+      size_t quality = 0;
+      while (read < size && quality < record.length) {
+        if (!IsNewline(data[read])) {
+          quality++;
+        }
+        read++;
+      }
+      if (quality != record.length) {
+        throw string("MappedRecords: FASTQ record " + record.name + " has truncated quality");
+      }
+    }
+
+    records.push_back(record);
+  }
+
+  data[length++] = kSentinel;
+  return Text(data, length);
+}
@@ -4,11 +4,22 @@
 #include <iostream>
 #include <algorithm>
 #include <cstdarg>
+#include <cstdint>
+#include <limits>
+#include <thread>
 using namespace std;
 
 #include "lcp.h"
+#include "engines.h"
+#include "succinct.h"
+#include "verify.h"
+#include "sais.h"
+#include "timer.h"
+#include "counters.h"
+#include "compare.h"
+#include "parallel.h"
 
-#define foreach(Type, data) for (vector<Type>::iterator it = data.begin(); it != data.end(); ++it)
+#define foreach(Type, data) for (typename vector<Type>::iterator it = data.begin(); it != data.end(); ++it)
 
 //#define LOGGING_ENABLED
 
@@ -28,6 +39,34 @@ void log(const char *format, ...) {
 }
 #endif
 
+/*
+ * Returns the length of the common prefix of the suffixes at a and b,
+ * looking at no more than 'length' characters, with the comparison kernel
+ * of the text's representation. The sentinel at the end matches no other
+ * character, so the comparison stops before it, and before any implicit
+ * one.
+ */
+inline size_t TextCommonPrefix(const Text& input, size_t a, size_t b, size_t length) {
+  const size_t last = max(a, b);
+  const size_t end = min(input.stored, input.length() - 1);
+  if (last + length > end) {
+    length = last < end ? end - last : 0;
+  }
+  if (input.packed != NULL) {
+    return input.packed->CommonPrefix(a, b, length);
+  }
+  return CommonPrefix(input.data + a, input.data + b, length);
+}
+
+/*
+ * Returns true if the suffixes at a and b start with the same letter. The
+ * sentinel at the end is a letter of its own.
+ */
+inline bool SameLetter(const Text& input, size_t a, size_t b) {
+  const size_t sentinel = input.length() - 1;
+  return input.at(a) == input.at(b) && a != sentinel && b != sentinel;
+}
+
 /*
  * Enumerates suffix types, L, S , and S*
  */
@@ -39,274 +78,412 @@ enum SuffixType {
 
 
 /*
- * Element of a bucket, contains suffix index, its type and lcp.
+ * Suffix types of all positions, packed one bit per position, set for S
+ * and S* suffixes. A suffix is S* if it is S and the suffix before it is
+ * L, which is tested from the two bits rather than stored.
  */
-class BucketElement {
+class SuffixTypes {
   public:
-  int suffix_index;
-  SuffixType type;
-  int lcp;
+  vector<uint64_t> bits;
   
-  BucketElement() {
-    suffix_index = -1;
-    type = kL;
-    lcp = -1;
+/*
+ * Returns true if the suffix at i is S or S*.
+ */
+  bool IsS(size_t i) const {
+    return (bits[i >> 6] >> (i & 63)) & 1;
   }
   
-  BucketElement(int suffix_index_, SuffixType type_) {
-    suffix_index = suffix_index_;
-    type = type_;
-    lcp = -1;
+/*
+ * Returns true if the suffix at i is L.
+ */
+  bool IsL(size_t i) const {
+    return !IsS(i);
   }
   
-  BucketElement(int suffix_index_, SuffixType type_, int lcp_) {
-    suffix_index = suffix_index_;
-    type = type_;
-    lcp = lcp_;
+/*
+ * Returns true if the suffix at i is S*.
+ */
+  bool IsSStar(size_t i) const {
+    return i > 0 && IsS(i) && !IsS(i - 1);
+  }
+  
+/*
+ * Returns the number of S* suffixes, from the S bits that follow an L bit.
+ * The bit before position 0 counts as S, as that suffix is never S*.
+ */
+  size_t CountSStar() const {
+    size_t count = 0;
+    uint64_t previous = ~0ULL;
+    for (size_t w = 0; w < bits.size(); w++) {
+      count += __builtin_popcountll(bits[w] & ~(bits[w] << 1 | previous >> 63));
+      previous = bits[w];
+    }
+    return count;
+  }
+  
+/*
+ * Returns the type of the suffix at i.
+ */
+  SuffixType Type(size_t i) const {
+    return IsSStar(i) ? kS_star : IsS(i) ? kS : kL;
   }
 };
 
 /*
- * Container for bucket elements.
+ * Bucket of suffixes starting with the same letter. Buckets don't own
+ * their elements, they are [begin, end) ranges of the flat element arrays
+ * kept by BucketArray. Head and tail are absolute element indices.
  */
+template<class Index>
 class Bucket {
   public:
   char letter;
-  vector<BucketElement> elements;
-  int head, tail;
-  
-  vector<int> suffix_index_to_element_index;
+  int id;
+  Index begin, end;
+  Index head, tail;
   
-  Bucket(char letter_, int size, int input_size) {
+  Bucket(char letter_, int id_, Index begin_, Index end_) {
     letter = letter_;
-    elements.resize(size);
-    suffix_index_to_element_index.resize(input_size, -1);
-    head = 0;
-    tail = size-1;
-  }
-  
-  /*
-   * Puts a bucket element at the first empty slot from the back.
-   */
-  void PutBack(BucketElement element) {
-    if (tail < 0) {
-      throw string("PutBack: bucket is full");
-    }
-    elements.at(tail) = element;
-    suffix_index_to_element_index.at(element.suffix_index) = tail;
-    tail--;
+    id = id_;
+    begin = begin_;
+    end = end_;
+    head = begin;
+    tail = end-1;
   }
   
 /*
- * Puts a bucket element at the first empty slot from the front.
+ * Resets the head and tail pointers.
  */
-  void PutFront(BucketElement element) {
-    if (head >= (int)elements.size()) {
-      throw string("PutFront: bucket is full");
-    }
-    elements.at(head) = element;
-    suffix_index_to_element_index.at(element.suffix_index) = head;
-    head++;
+  void ResetPointers() {
+    head = begin;
+    tail = end - 1;
   }
   
 /*
  * Resets the tail pointer.
  */
   void ResetTailPointer() {
-    tail = elements.size() - 1;
+    tail = end - 1;
   }
-  
+};
+
 /*
- * Finds and returns the index of the bucket element with this suffix index.
+ * All buckets laid out one after another, in alphabetical order of their
+ * letters, over two parallel arrays: the suffix index and the lcp of every
+ * element, -1 in empty slots. Steps 2 and 3 only sort the suffixes, so
+ * they stream the suffix indices alone.
  */
-  int Find(int suffix_index) {
-    return suffix_index_to_element_index.at(suffix_index);
+template<class Index>
+class BucketArray {
+  public:
+  vector<Index> suffixes;
+  vector<Index> lcps;
+  vector<Bucket<Index> > buckets;
+  int bucket_of[256];
+  
+  BucketArray() {
   }
-
+  
+  BucketArray(const Text& input) {
+    Layout(input);
+  }
+  
 /*
- * Prints the bucket elements of this bucket.
+ * Lays out empty buckets for the letters of the input. The sentinel at the
+ * end sorts before all letters, whatever its byte, so it gets the first
+ * bucket, of its own. Buffers of a previous input are reused.
  */
-  void Print() {
-    log("bucket: %c\n", letter);
-    for (vector<BucketElement>::iterator it = elements.begin(); it != elements.end(); ++it) {
-      log("%d %c %d\n", it->suffix_index, it->type, it->lcp);
+  void Layout(const Text& input) {
+    const Index n = input.length();
+    Index counts[256] = {0};
+    if (input.packed != NULL) {
+      copy(input.packed->counts, input.packed->counts + 256, counts);
+    } else {
+      for (Index i = 0; i < n; i++) {
+        counts[(unsigned char)input[i]]++;
+      }
     }
+    Place(counts, n > 0, n > 0 ? input[n-1] : 0);
+    suffixes.assign(n, -1);
+    lcps.assign(n, -1);
   }
-
+  
 /*
- * Prints all of lcp values of this bucket's elements.
+ * Places the buckets of the letter counts one after another, without
+ * touching the element arrays. The counts include the sentinel, if there
+ * is one.
  */
-  void PrintSeq() {
-    for (vector<BucketElement>::iterator it = elements.begin(); it != elements.end(); ++it) {
-      if (it->lcp < 0) {
-        log("x ");
-      } else {
-        log("%d ", it->lcp);
+  void Place(Index counts[256], bool has_sentinel, char sentinel) {
+    Index begin = 0;
+    buckets.clear();
+    if (has_sentinel) {
+      counts[(unsigned char)sentinel]--;
+      buckets.push_back(Bucket<Index>(sentinel, 0, 0, 1));
+      begin = 1;
+    }
+    
+    // letters are compared as chars everywhere else, so buckets follow
+    // the (signed) char order as well
+    for (int c = -128; c < 128; c++) {
+      unsigned char letter = (unsigned char)c;
+      if (counts[letter] == 0) {
+        bucket_of[letter] = -1;
+        continue;
       }
+      bucket_of[letter] = buckets.size();
+      buckets.push_back(Bucket<Index>((char)c, buckets.size(), begin, begin + counts[letter]));
+      begin += counts[letter];
     }
   }
-};
-
+  
 /*
- * Characteristic name of the suffix.
- * Stores lcp as well.
+ * Empties all buckets, so they can be filled again.
  */
-class Name {
-  public:
-  int index;
-  string name;
+  void Reset() {
+    fill(suffixes.begin(), suffixes.end(), -1);
+    fill(lcps.begin(), lcps.end(), -1);
+    for (typename vector<Bucket<Index> >::iterator it = buckets.begin(); it != buckets.end(); ++it) {
+      it->ResetPointers();
+    }
+  }
+  
+/*
+ * Puts a suffix at the first empty slot from the back of the bucket.
+ */
+  void PutBack(Bucket<Index>& bucket, Index suffix_index) {
+    if (bucket.tail < bucket.begin) {
+      throw string("PutBack: bucket is full");
+    }
+    suffixes[bucket.tail] = suffix_index;
+    bucket.tail--;
+  }
   
-  int lcp;
+/*
+ * Same, with the lcp of the suffix.
+ */
+  void PutBack(Bucket<Index>& bucket, Index suffix_index, Index lcp) {
+    PutBack(bucket, suffix_index);
+    lcps[bucket.tail + 1] = lcp;
+  }
   
-  Name(int index_, string name_) {
-    index = index_;
-    name = name_;
-    lcp = -1;
+/*
+ * Puts a suffix at the first empty slot from the front of the bucket.
+ */
+  void PutFront(Bucket<Index>& bucket, Index suffix_index) {
+    if (bucket.head >= bucket.end) {
+      throw string("PutFront: bucket is full");
+    }
+    suffixes[bucket.head] = suffix_index;
+    bucket.head++;
   }
   
 /*
- * Makes a suffix, given the input string.
+ * Same, with the lcp of the suffix.
  */
-  string GetSuffix(string& input) {
-    return input.substr(index);
+  void PutFront(Bucket<Index>& bucket, Index suffix_index, Index lcp) {
+    PutFront(bucket, suffix_index);
+    lcps[bucket.head - 1] = lcp;
   }
   
- /*
- * Calculates suffix lcp.
+/*
+ * Prints the bucket elements of all buckets, with the types of their suffixes.
  */
-  int SuffixLCP(Name& n, string& input) {
-    int len = min(name.length(), n.name.length());
-    for (int i = 0; i < len; i++) {
-      if (name.at(i) != n.name.at(i)) {
-        return i;
+  void Print(const SuffixTypes& types) {
+    for (typename vector<Bucket<Index> >::iterator it = buckets.begin(); it != buckets.end(); ++it) {
+      log("bucket: %c\n", it->letter);
+      for (Index i = it->begin; i < it->end; i++) {
+        log("%lld %c %lld\n", (long long)suffixes[i], suffixes[i] < 0 ? '-' : (char)types.Type(suffixes[i]), (long long)lcps[i]);
       }
     }
-    return len;
   }
-};
-
-void UpdateBorder(int position, Bucket& bucket, vector<SuffixType>& types, string& input);
-void UpdateBorderToLeft(int position, Bucket& bucket, vector<SuffixType>& types, string& input);
 
 /*
- * Calculates lcp of two strings, a and b.
+ * Prints all of lcp values of the bucket elements.
  */
-int Lcp(const string& a, const string& b) {
-  int len = min(a.length(), b.length());
-  for (int i = 0; i < len; i++) {
-    if (a.at(i) != b.at(i)) {
-      return i;
+  void PrintSeq() {
+    for (typename vector<Index>::iterator it = lcps.begin(); it != lcps.end(); ++it) {
+      if (*it < 0) {
+        log("x ");
+      } else {
+        log("%lld ", (long long)*it);
+      }
     }
   }
-  return len;
-}
+};
 
 /*
- * Comparator object for the Name class.
+ * Range minimum structure for the lcp induction in step 4. The induction
+ * scans the bucket elements in order, and each query asks for the minimal
+ * lcp between the scanned element and the element from which the previous
+ * suffix was induced into the same bucket. The scanned lcps are kept on a
+ * stack of suffix minima, increasing from the bottom, as an lcp hides all
+ * larger ones scanned before it, so a scan costs amortized O(1). Every
+ * bucket keeps the number of lcps scanned at its last induction, and a
+ * query returns the lowest entry of the stack scanned after that, found by
+ * a binary search in O(log n).
  */
-struct NameComparator {
-  string& input;
+template<class Index>
+class LcpMinima {
+  public:
+  vector<Index> scans;
+  vector<Index> lcps;
+  vector<Index> last;
+  Index scanned;
   
-  NameComparator(string& input_) : input(input_) {
+  LcpMinima() {
+    scanned = 0;
   }
   
-  bool operator()(const Name& a, const Name& b) {
-    int i = a.index;
-    int j = b.index;
-    int n = input.length();
-    while (i < n && j < n) {
-      if (input.at(i) < input.at(j)) {
-        return true;
-      } else if (input.at(i) > input.at(j)) {
-        return false;
-      }
-      i++;
-      j++;
+  LcpMinima(int bucket_count) {
+    Reset(bucket_count);
+  }
+  
+  /*
+   * Starts over with empty ranges for the given number of buckets.
+   */
+  void Reset(int bucket_count) {
+    scans.clear();
+    lcps.clear();
+    last.assign(bucket_count, 0);
+    scanned = 0;
+  }
+  
+  /*
+   * Larger than any lcp value.
+   */
+  static Index NoLcp() {
+    return numeric_limits<Index>::max();
+  }
+  
+  /*
+   * Adds the lcp of the element that was just scanned to all ranges.
+   */
+  void Scan(Index lcp) {
+    scanned++;
+    while (!lcps.empty() && lcps.back() >= lcp) {
+      COUNT(min_lcp_scans, 1);
+      scans.pop_back();
+      lcps.pop_back();
     }
-    return true;
+    scans.push_back(scanned);
+    lcps.push_back(lcp);
+  }
+  
+  /*
+   * Returns the minimal lcp scanned since the previous induction into the
+   * bucket, and starts a new range for it.
+   */
+  Index Induce(int bucket) {
+    size_t k = upper_bound(scans.begin(), scans.end(), last[bucket]) - scans.begin();
+    last[bucket] = scanned;
+    return k < lcps.size() ? lcps[k] : NoLcp();
   }
 };
 
 /*
- * Calculates array of suffix types from the given input string.
+ * Characteristic name of the suffix, kept as a view into the input: the
+ * name is 'length' characters starting at 'index'.
+ * Stores lcp as well.
  */
-vector<SuffixType> CreateSuffixTypeArray(string input) {
-  const int n = input.length();
-  vector<SuffixType> types(n);
-  types.at(n-1) = kS;
+template<class Index>
+class Name {
+  public:
+  Index index;
+  Index length;
   
-  for (int i = n-2; i >= 0; i--) {
-    if (input.at(i) < input.at(i+1)) {
-      types.at(i) = kS;
-    } else if (input.at(i) > input.at(i+1)) {
-      types.at(i) = kL;
-      if (types.at(i+1) == kS) {
-        types.at(i+1) = kS_star;
-      }
-    } else {
-      types.at(i) = types.at(i+1);
-    }
+  Index lcp;
+  
+  Name(Index index_, Index length_) {
+    index = index_;
+    length = length_;
+    lcp = -1;
   }
   
-  return types;
-}
-
 /*
- * returns distinct letters from the given string, sorted in
- * alphabetical order.
+ * Makes a suffix, given the input string.
  */
-string DistinctLetters(string& str) {
-  vector<char> chars(str.begin(), str.end());
-  sort(chars.begin(), chars.end());
-  unsigned int i = 0;
-  while (i < chars.size() - 1) {
-    if (chars.at(i) == chars.at(i+1)) {
-      chars.erase(chars.begin() + i);
-    } else {
-      i++;
+  string GetSuffix(const Text& input) {
+    string suffix;
+    for (size_t i = index; i < input.length(); i++) {
+      suffix += input[i];
     }
+    return suffix;
   }
-  string ret(chars.begin(), chars.end());
-  return ret;
-}
+  
+ /*
+ * Calculates suffix lcp.
+ */
+  Index SuffixLCP(const Name& n, const Text& input) const {
+    Index len = min(length, n.length);
+    Index lcp = TextCommonPrefix(input, index, n.index, len);
+    COUNT(name_chars, lcp < len ? lcp + 1 : lcp);
+    return lcp;
+  }
+};
 
 /*
- * Counts the occurrences of 'letter' in string 'in'.
+ * Buffers of one construction with Index as the type of indices and lcps.
+ * Kept in an LcpContext between runs, so the buffers of one input are
+ * reused for the next.
  */
-int Count(char letter, string& in) {
-  int ret = 0;
-  for (string::iterator it = in.begin(); it != in.end(); ++it) {
-    if (*it == letter) {
-      ++ret;
-    }
-  }
-  return ret;
+template<class Index>
+class Workspace {
+  public:
+  BucketArray<Index> buckets;
+  SuffixTypes types;
+  vector<Name<Index> > names;
+  vector<Name<Index> > sorted;
+  vector<long long> weight_prefix;
+  vector<Index> rank;
+  vector<Index> reduced;
+  vector<Index> s_star;
+  vector<Index> reduced_sa;
+  LcpMinima<Index> minima;
+  SaisWorkspace<Index> sais;
+};
+
+/*
+ * Calculates lcp of two strings, a and b.
+ */
+int Lcp(const string& a, const string& b) {
+  return CommonPrefix(a.data(), b.data(), min(a.length(), b.length()));
 }
 
 /*
- * Creates the initial empty buckets.
+ * Calculates the suffix types of the given input string, into types. A
+ * suffix has the type of the next one if both start with the same letter.
+ * The sentinel is S, and smaller than any letter, so the suffix before it
+ * is L. Bits are gathered in a word and stored once it is complete.
  */
-vector<Bucket> CreateBuckets(string& input) {
-  vector<Bucket> buckets;
-  string distinct = DistinctLetters(input);
+void CreateSuffixTypeArray(const Text& input, SuffixTypes& types) {
+  const long long n = input.length();
+  types.bits.resize((n + 63) / 64);
   
-  for (string::iterator it = distinct.begin(); it != distinct.end(); ++it) {
-    char c = *it;
-    Bucket b(c, Count(c, input), input.length());
-    buckets.push_back(b);
+  bool s_type = true;
+  uint64_t word = 0;
+  for (long long i = n-1; i >= 0; i--) {
+    if (i == n-2) {
+      s_type = false;
+    } else if (i < n-2 && input.at(i) != input.at(i+1)) {
+      s_type = input.at(i) < input.at(i+1);
+    }
+    word |= (uint64_t)s_type << (i & 63);
+    if ((i & 63) == 0) {
+      types.bits[i >> 6] = word;
+      word = 0;
+    }
   }
-  
-  return buckets;
 }
 
 /*
  * Gets the bucket with the letter 'letter'.
  */
-Bucket& GetBucket(vector<Bucket>& buckets, char letter) {
-  for (int i = 0; i < (int)buckets.size(); i++) {
-    if (buckets[i].letter == letter) {
-      return buckets[i];
-    }
+template<class Index>
+Bucket<Index>& GetBucket(BucketArray<Index>& buckets, char letter) {
+  COUNT(bucket_lookups, 1);
+  int index = buckets.bucket_of[(unsigned char)letter];
+  if (index >= 0) {
+    return buckets.buckets[index];
   }
   string msg = "Could not find bucket with letter ";
   msg += letter;
@@ -314,15 +491,27 @@ Bucket& GetBucket(vector<Bucket>& buckets, char letter) {
 }
 
 
+/*
+ * Gets the bucket of the suffix at i, the sentinel's own bucket for the
+ * last one.
+ */
+template<class Index>
+Bucket<Index>& GetSuffixBucket(BucketArray<Index>& buckets, const Text& input, Index i) {
+  if (i == (Index)input.length() - 1) {
+    return buckets.buckets[0];
+  }
+  return GetBucket(buckets, input.at(i));
+}
+
 /* Algorithm step 2.1)
  * - Adding all S* suffixes into buckets
  *  */
-void AddSStarSuffix(vector<Bucket>& buckets, vector<SuffixType>& types, string& input) {
-  for (unsigned int i = 0; i < input.length(); i++) {
-    if (types.at(i) == kS_star) {
-      Bucket& bucket = GetBucket(buckets, input.at(i));
-      BucketElement element(i, types.at(i));
-      bucket.PutBack(element);
+template<class Index>
+void AddSStarSuffix(BucketArray<Index>& buckets, const SuffixTypes& types, const Text& input) {
+  for (Index i = 0; i < (Index)input.length(); i++) {
+    if (types.IsSStar(i)) {
+      Bucket<Index>& bucket = GetSuffixBucket(buckets, input, i);
+      buckets.PutBack(bucket, i);
     } 
   }
 }
@@ -330,19 +519,16 @@ void AddSStarSuffix(vector<Bucket>& buckets, vector<SuffixType>& types, string&
 /* Algorithm step 2.2)
  * - Adding all L suffixes into buckets
  * */
-void AddLSuffixes(vector<Bucket>& buckets, vector<SuffixType>& types, string& input) {
-  for (unsigned int i = 0; i < buckets.size(); i++) {
-    vector<BucketElement>& elements = buckets.at(i).elements;
-    
-    for (unsigned int j = 0; j < elements.size(); j++) {
-      BucketElement& element = elements.at(j);
-      if (element.suffix_index > 0) {
-        int index = element.suffix_index - 1;  
-        if (types.at(index) == kL) {
-          Bucket& into = GetBucket(buckets, input.at(index));
-          BucketElement newElement(index, types.at(index));
-          into.PutFront(newElement);
-        }
+template<class Index>
+void AddLSuffixes(BucketArray<Index>& buckets, const SuffixTypes& types, const Text& input) {
+  vector<Index>& suffixes = buckets.suffixes;
+  
+  for (Index j = 0; j < (Index)suffixes.size(); j++) {
+    if (suffixes[j] > 0) {
+      Index index = suffixes[j] - 1;
+      if (types.IsL(index)) {
+        Bucket<Index>& into = GetBucket(buckets, input.at(index));
+        buckets.PutFront(into, index);
       }
     }
   }
@@ -351,133 +537,197 @@ void AddLSuffixes(vector<Bucket>& buckets, vector<SuffixType>& types, string& in
 /* Algorithm step 2.3)
  * - Adding all S suffixes into buckets
  * */
-void AddSSuffixes(vector<Bucket>& buckets, vector<SuffixType>& types, string& input) {
-  for (vector<Bucket>::iterator it = buckets.begin(); it != buckets.end(); ++it) {
+template<class Index>
+void AddSSuffixes(BucketArray<Index>& buckets, const SuffixTypes& types, const Text& input) {
+  foreach(Bucket<Index>, buckets.buckets) {
     it->ResetTailPointer();
   }
   
-  for (int i = buckets.size()-1; i >= 0; i--) {
-    vector<BucketElement>& elements = buckets.at(i).elements;
-    
-    for (int j = elements.size()-1; j >= 0; j--) {
-      BucketElement& element = elements.at(j);
-      if (element.suffix_index > 0) {
-        int index = element.suffix_index - 1;
-        if (types.at(index) == kS || types.at(index) == kS_star) {
-          Bucket& into = GetBucket(buckets, input.at(index));
-          BucketElement new_element(index, types.at(index));
-          into.PutBack(new_element);
-        }
+  vector<Index>& suffixes = buckets.suffixes;
+  
+  for (Index j = suffixes.size()-1; j >= 0; j--) {
+    if (suffixes[j] > 0) {
+      Index index = suffixes[j] - 1;
+      if (types.IsS(index)) {
+        Bucket<Index>& into = GetBucket(buckets, input.at(index));
+        buckets.PutBack(into, index);
       }
     }
   }
 }
 
 /*
- * Returns the characteristic name of the suffix at given index in string.
+ * Returns the length of the characteristic name of the suffix at given
+ * index in string. The name reaches up to and including the next S* suffix.
  */
-string GetName(int index, string& in, vector<SuffixType> types) {
-  string ret;
-  ret += in.at(index);
-  for (unsigned int i = index; i < in.length()-1; i++) {
-    ret += in.at(i+1);
-    if (types.at(i+1) == kS_star) {
-      break;
-    }
+template<class Index>
+Index GetNameLength(Index index, const Text& in, const SuffixTypes& types) {
+  const Index n = in.length();
+  Index i = index + 1;
+  while (i < n && !types.IsSStar(i)) {
+    i++;
   }
-  return ret;
+  return i < n ? i - index + 1 : n - index;
 }
 
 /* Algorithm step 3.
- * - Returns characteristic names of all S* suffixes.
+ * - Puts characteristic names of all S* suffixes into names.
  * */
-vector<Name> GetNames(vector<Bucket>& buckets, vector<SuffixType>& types, string& input) {
-  vector<Name> names;
+template<class Index>
+void GetNames(BucketArray<Index>& buckets, const SuffixTypes& types, const Text& input, vector<Name<Index> >& names) {
+  vector<Index>& suffixes = buckets.suffixes;
+  names.clear();
+  names.reserve(types.CountSStar());
   
-  for (unsigned int i = 0; i < buckets.size(); i++) {
-    Bucket& bucket = buckets.at(i);
-    vector<BucketElement>& elements = bucket.elements;
-    
-    for (unsigned int j = 0; j < elements.size(); j++) {
-      if (elements.at(j).type == kS_star) {
-        string name = GetName(elements.at(j).suffix_index, input, types);
-        Name chName(elements.at(j).suffix_index, name);
-        names.push_back(chName);
-      }
+  for (Index j = 0; j < (Index)suffixes.size(); j++) {
+    if (suffixes[j] > 0 && types.IsSStar(suffixes[j])) {
+      Index index = suffixes[j];
+      names.push_back(Name<Index>(index, GetNameLength(index, input, types)));
     }
   }
-  
-  return names;
 }
 
-typedef vector<Name> Names;
+/*
+ * Number of threads the construction may use.
+ */
+int construction_threads = max(1, (int)thread::hardware_concurrency());
 
-/* Algorithm step 3.1)
- * Creates and returns categories which contain names and indicies of S* suffixes.
- * */
-vector<Names> GetCategories(vector<Name>& names) {
-  vector<Names> categories;
-  vector<Name> first;
-  first.push_back(names.at(0));
-  categories.push_back(first);
-  
-  int category = 0;
-  for (int i = 1; i < (int)names.size(); i++) {
-    if (names.at(i).name != names.at(i-1).name) {
-      vector<Name> new_category;
-      categories.push_back(new_category);
-      category++;
-    }
-    categories.at(category).push_back(names.at(i));
+/*
+ * Sets the number of threads the construction may use, all cores by default.
+ */
+void SetConstructionThreads(int threads) {
+  construction_threads = max(1, threads);
+}
+
+/* Algorithm step 3.2)
+ * Initial lcp calculations, calculates lcp values between every two
+ * neighbouring names in the list. The pairs are independent, so they are
+ * split across threads, into ranges of about the same total name length
+ * rather than the same number of names, as a comparison is at most as long
+ * as the shorter name.
+ *  */
+template<class Index>
+void LcpInitial(vector<Name<Index> >& names, const Text& input, vector<long long>& weight_prefix) {
+  const Index m = names.size();
+  weight_prefix.assign(m + 1, 0);
+  for (Index i = 0; i < m; i++) {
+    weight_prefix[i+1] = weight_prefix[i] + names[i].length;
   }
   
-  return categories;
+  ParallelRanges(weight_prefix, construction_threads, [&names, &input](long long begin, long long end) {
+    for (Index i = max(begin, 1LL); i < end; i++) {
+      names[i].lcp = names[i].SuffixLCP(names[i-1], input);
+    }
+  });
+  names.at(0).lcp = 0;
 }
 
 /*
- * Joins all the names in the category into one array and returns it.
+ * Extends the lcps of neighbouring sorted names that cover the shorter
+ * name to the full lcps of their suffixes. One name is then a prefix of the
+ * other, which ends within a run of its last letter, so the comparison
+ * stops within the longer name.
  */
-vector<Name> Flatten(vector<Names>& categories, string& input) {
-  NameComparator name_comparator(input);
-  vector<Name> names;
+template<class Index>
+void ExtendNameLcps(vector<Name<Index> >& names, const Text& input) {
+  for (Index i = 1; i < (Index)names.size(); i++) {
+    if (names[i].lcp >= min(names[i].length, names[i-1].length)) {
+      names[i].lcp = Lcp(names[i].index, names[i-1].index, input);
+    }
+  }
+}
+
+/* Algorithm step 3.1)
+ * Sorts the S* suffixes, given their names in sorted order, and calculates
+ * their lcps (step 3.2). Each name gets its rank among the distinct names,
+ * neighbouring names being the same if their lcp covers them. If all names
+ * are different, they are already in the order of their suffixes, and the
+ * lcps of the names give those of the suffixes. Otherwise the ranks of the
+ * S* suffixes in text order form a reduced string, and its suffix array
+ * gives the order of the S* suffixes. The lcps of the reduced string, from
+ * Kasai's algorithm over it, count the equal names the suffixes start
+ * with, which cover the text up to the S* suffix as many names later. The
+ * text is compared only from there on, and only up to the first letter in
+ * which the next names differ.
+ * */
+template<class Index>
+vector<Name<Index> >& SortNames(vector<Name<Index> >& names, const SuffixTypes& types, const Text& input, Workspace<Index>& workspace) {
+  const Index m = names.size();
+  LcpInitial(names, input, workspace.weight_prefix);
   
-  for (vector<Names>::iterator it = categories.begin(); it != categories.end(); ++it) {
-    if (it->size() > 1) {
-      sort(it->begin(), it->end(), name_comparator);
+  // S* suffixes are at least two apart, so index/2 identifies them
+  vector<Index>& rank = workspace.rank;
+  rank.resize(input.length()/2 + 1);
+  Index name_rank = 0;
+  for (Index i = 0; i < m; i++) {
+    if (i > 0 && (names[i].length != names[i-1].length || names[i].lcp < names[i].length)) {
+      name_rank++;
     }
-    for (vector<Name>::iterator name = it->begin(); name != it->end(); ++name) {
-      names.push_back(*name);
+    rank[names[i].index/2] = name_rank;
+  }
+  if (name_rank + 1 == m) {
+    ExtendNameLcps(names, input);
+    return names;
+  }
+  
+  vector<Index>& reduced = workspace.reduced;
+  vector<Index>& s_star = workspace.s_star;
+  reduced.clear();
+  s_star.clear();
+  reduced.reserve(m);
+  s_star.reserve(m);
+  for (Index i = 0; i < (Index)input.length(); i++) {
+    if (types.IsSStar(i)) {
+      reduced.push_back(rank[i/2]);
+      s_star.push_back(i);
     }
   }
   
-  return names;
-}
-
-/* Algorithm step 3.2)
- * Initial lcp calculations, calculates lcp values between every two
- * neighbouring names in the list.
- *  */
-void LcpInitial(vector<Name>& names, string& input) {
-  names.at(0).lcp = 0;
-  for (int i = 1; i < (int)names.size(); i++) {
-    names.at(i).lcp = names.at(i).SuffixLCP(names.at(i-1), input);
+  vector<Index>& reduced_sa = workspace.reduced_sa;
+  SuffixArray(reduced, name_rank + 1, reduced_sa, workspace.sais);
+  for (Index k = 0; k < m; k++) {
+    rank[s_star[reduced_sa[k]]/2] = k;
+  }
+  
+  vector<Name<Index> >& sorted = workspace.sorted;
+  sorted.assign(m, names[0]);
+  for (Index i = 0; i < m; i++) {
+    sorted[rank[names[i].index/2]] = names[i];
   }
+  
+  // the last S* suffix is the sentinel, whose name is unique, so the equal
+  // names end before it
+  sorted[0].lcp = 0;
+  Index h = 0;
+  for (Index a = 0; a < m; a++) {
+    Index k = rank[s_star[a]/2];
+    if (k == 0) {
+      h = 0;
+      continue;
+    }
+    Index b = reduced_sa[k-1];
+    while (reduced[a+h] == reduced[b+h]) {
+      h++;
+    }
+    sorted[k].lcp = s_star[a+h] - s_star[a] + Lcp(s_star[a+h], s_star[b+h], input);
+    if (h > 0) {
+      h--;
+    }
+  }
+  return sorted;
 }
 
 /* Algorithm step 4.1)
- * - Inserts all S* suffixes into buckets, and updates L/S borders if needed.
+ * - Inserts all S* suffixes into buckets, with their lcps from step 3.
  * */
-void LastStepSStar(vector<Bucket>& buckets, vector<Name>& names, vector<SuffixType>& types, string& input) {
-  for (int j = (int)names.size()-1; j >= 0; j--) {
-    Name& name = names.at(j);
-    int i = name.index;
-    if (types.at(i) == kS_star) {
-      Bucket& bucket = GetBucket(buckets, input.at(i));
-      BucketElement element(i, types.at(i), name.lcp);
-      bucket.PutBack(element);
-      if (bucket.tail < (int)bucket.elements.size() - 2) {
-        UpdateBorder(bucket.tail+2, bucket, types, input);
-      }
+template<class Index>
+void LastStepSStar(BucketArray<Index>& buckets, vector<Name<Index> >& names, const SuffixTypes& types, const Text& input) {
+  for (Index j = (Index)names.size()-1; j >= 0; j--) {
+    Name<Index>& name = names.at(j);
+    Index i = name.index;
+    if (types.IsSStar(i)) {
+      Bucket<Index>& bucket = GetSuffixBucket(buckets, input, i);
+      buckets.PutBack(bucket, i, name.lcp);
     }
   }
 }
@@ -485,146 +735,95 @@ void LastStepSStar(vector<Bucket>& buckets, vector<Name>& names, vector<SuffixTy
 /*
  * Inserts an L suffix into a bucket that already contains at least one L suffix.
  */
-void InsertNotFirstL(int index, vector<Bucket>& buckets, Bucket& bucket, vector<SuffixType>& types, string& input) {
-  BucketElement elem(index, types.at(index), 0);
-        
-  BucketElement& prevL = bucket.elements.at(bucket.head - 1);
-  int suffixA = elem.suffix_index + 1;
-  int suffixB = prevL.suffix_index + 1;
-  
-  if (input.at(suffixA) == input.at(suffixB)) {
-    Bucket& bucket_for_suffix = GetBucket(buckets, input[suffixA]);
-    int indexA = bucket_for_suffix.Find(suffixA);
-    int indexB = bucket_for_suffix.Find(suffixB);
-    int begin = 1 + min(indexA, indexB);
-    int end = max(indexA, indexB);
-    int minLcp = 1000000000;
-    for (; begin <= end; begin++) {
-      BucketElement& element = bucket_for_suffix.elements.at(begin);
-      if (element.lcp != -1 && element.lcp < minLcp) {
-        minLcp = element.lcp;
-      }
-    }
-    elem.lcp = minLcp + 1;
+template<class Index>
+void InsertNotFirstL(Index index, BucketArray<Index>& buckets, Bucket<Index>& bucket, LcpMinima<Index>& minima, const Text& input) {
+  Index suffixA = index + 1;
+  Index suffixB = buckets.suffixes[bucket.head - 1] + 1;
+  
+  // minimal lcp between the elements of suffixA and suffixB
+  Index minLcp = minima.Induce(bucket.id);
+  Index lcp;
+  if (SameLetter(input, suffixA, suffixB)) {
+    lcp = minLcp + 1;
   } else {
-    elem.lcp = 1;
+    lcp = 1;
   }
   
-  bucket.PutFront(elem);
+  buckets.PutFront(bucket, index, lcp);
 }
 
 /*
  * Inserts an S/S* suffix into a bucket that already contains at least one S/S* suffix.
+ * The induced lcp is the lcp with the previously inserted suffix, which now
+ * becomes the right neighbour, so it is stored there.
  */
-void InsertNotFirstS(int index, vector<Bucket>& buckets, Bucket& bucket, vector<SuffixType>& types, string& input) {
-  BucketElement elem(index, types.at(index), 0);
-        
-  BucketElement& prev = bucket.elements.at(bucket.tail + 1);
-  int suffixA = elem.suffix_index + 1;
-  int suffixB = prev.suffix_index + 1;
-  
-  if (input.at(suffixA) == input.at(suffixB)) {
-    Bucket& bucket_for_suffix = GetBucket(buckets, input[suffixA]);
-    int indexA = bucket_for_suffix.Find(suffixA);
-    int indexB = bucket_for_suffix.Find(suffixB);
-    int begin = 1 + min(indexA, indexB);
-    int end = max(indexA, indexB);
-    int minLcp = 1000000000;
-    for (; begin <= end; begin++) {
-      BucketElement& element = bucket_for_suffix.elements.at(begin);
-      if (element.lcp < minLcp) {
-        minLcp = element.lcp;
-      }
-    }
-    elem.lcp = minLcp + 1;
+template<class Index>
+void InsertNotFirstS(Index index, BucketArray<Index>& buckets, Bucket<Index>& bucket, LcpMinima<Index>& minima, const Text& input) {
+  Index suffixA = index + 1;
+  Index suffixB = buckets.suffixes[bucket.tail + 1] + 1;
+  
+  // minimal lcp between the elements of suffixA and suffixB
+  Index minLcp = minima.Induce(bucket.id);
+  Index lcp;
+  if (SameLetter(input, suffixA, suffixB)) {
+    lcp = minLcp + 1;
   } else {
-    elem.lcp = 1;
+    lcp = 1;
   }
+  buckets.lcps[bucket.tail + 1] = lcp;
   
-  bucket.PutBack(elem);
-}
-
-/*
- * Updates border between two neighbouring bucket elements.
- * This is called only when updating the L/S border.
- */
-void UpdateLSBorder(Bucket& bucket, vector<SuffixType>& types, string& input) {
-  if (bucket.head < (int)bucket.elements.size()) {
-    BucketElement& elemA = bucket.elements.at(bucket.head - 1);
-    BucketElement& elemB = bucket.elements.at(bucket.head);
-    if (elemB.suffix_index != -1 && types.at(elemB.suffix_index) == kS_star) {
-      int lcp_value = Lcp(elemA.suffix_index, elemB.suffix_index, input);
-      elemB.lcp = lcp_value;
-    }
-  }
+  buckets.PutBack(bucket, index, lcp);
 }
 
 /*
- * Updates border between two bucket elements. They don't have to of
- * different suffixes, the only requirement is that they are next to
- * each other.
+ * Sets the lcp of the first S suffix of the bucket, at 'position', to its
+ * lcp with the last L suffix of the bucket, or to 0 if there is none. Both
+ * start with a run of the bucket's letter, followed by a smaller letter
+ * after the L suffix and by a larger one after the S suffix, so the
+ * comparison stops within the shorter run. Called once per bucket and step.
  */
-void UpdateBorder(int position, Bucket& bucket, vector<SuffixType>& types, string& input) {
-  BucketElement& elemA = bucket.elements.at(position);
-  if (position == 0) {
-    elemA.lcp = 0;
+template<class Index>
+void UpdateBorder(Index position, BucketArray<Index>& buckets, Bucket<Index>& bucket, const Text& input) {
+  COUNT(border_updates, 1);
+  if (bucket.head == bucket.begin) {
+    buckets.lcps[position] = 0;
     return;
   }
-  
-  BucketElement& elemB = bucket.elements.at(position - 1);
-  if (elemB.suffix_index != -1) {
-    int lcp_value = Lcp(elemA.suffix_index, elemB.suffix_index, input);
-    elemA.lcp = lcp_value;
-  }
-}
-
-/*
- * Updates border between two neighbouring elements. They don't have to
- * be of different suffix types, and there can be gaps in between them.
- */
-void UpdateBorderToLeft(int position, Bucket& bucket, vector<SuffixType>& types, string& input) {
-  BucketElement& elemA = bucket.elements.at(position);
-  if (position == 0) {
-    elemA.lcp = 0;
-    return;
-  }
-  
-  BucketElement& elemB = bucket.elements.at(position - 1);
-  if (elemB.suffix_index != -1) {
-    int lcp_value = Lcp(elemA.suffix_index, elemB.suffix_index, input);
-    elemA.lcp = lcp_value;
-  } else {
-    int index = bucket.head - 1;
-    if (index >= 0) {
-      BucketElement& elemC = bucket.elements.at(index);
-      int lcp_value = Lcp(elemA.suffix_index, elemC.suffix_index, input);
-      elemA.lcp = lcp_value;
-    }
-  }
+  buckets.lcps[position] = Lcp(buckets.suffixes[bucket.head - 1], buckets.suffixes[position], input);
 }
 
 /* Algorithm step 4.2)
  * Inserts L suffixes into buckets and updates lcps.
  * */
-void LastStepL(vector<Bucket>& buckets, vector<SuffixType>& types, string& input) {
-  for (int i = 0; i < (int)buckets.size(); i++) {
-    for (int j = 0; j < (int)buckets[i].elements.size(); j++) {
-      int index = buckets[i].elements[j].suffix_index - 1;
-      if (index >= 0 && types.at(index) == kL) {
-        Bucket& bucket = GetBucket(buckets, input.at(index));
-        if (bucket.head == 0) {
-          // there's no kL's in this bucket yet
-          BucketElement elem(index, kL, 0);
-          bucket.PutFront(elem);
-        } else {
-          // there are kL's in this bucket
-          InsertNotFirstL(index, buckets, bucket, types, input);
-        }
-        
-        //UpdateLSBorder(bucket, types, input);
-        if (bucket.tail < (int)bucket.elements.size() - 1) {
-          UpdateBorderToLeft(bucket.tail+1, bucket, types, input);
-        }
+template<class Index>
+void LastStepL(BucketArray<Index>& buckets, const SuffixTypes& types, const Text& input, LcpMinima<Index>& minima) {
+  minima.Reset(buckets.buckets.size());
+  
+  int scanned = 0;
+  for (Index j = 0; j < (Index)buckets.suffixes.size(); j++) {
+    // L suffixes are induced from smaller suffixes, so those of the bucket
+    // are all in once the scan reaches its first S* suffix
+    while (j >= buckets.buckets[scanned].end) {
+      scanned++;
+    }
+    if (j == buckets.buckets[scanned].tail + 1) {
+      UpdateBorder(j, buckets, buckets.buckets[scanned], input);
+    }
+    
+    if (buckets.lcps[j] != -1) {
+      minima.Scan(buckets.lcps[j]);
+    }
+    
+    Index index = buckets.suffixes[j] - 1;
+    if (index >= 0 && types.IsL(index)) {
+      Bucket<Index>& bucket = GetBucket(buckets, input.at(index));
+      if (bucket.head == bucket.begin) {
+        // there's no kL's in this bucket yet
+        buckets.PutFront(bucket, index, 0);
+        minima.Induce(bucket.id);
+      } else {
+        // there are kL's in this bucket
+        InsertNotFirstL(index, buckets, bucket, minima, input);
       }
     }
   }
@@ -633,62 +832,79 @@ void LastStepL(vector<Bucket>& buckets, vector<SuffixType>& types, string& input
 /* Algorithm step 4.3)
  * Inserts S/S* suffixes into buckets and updates lcps.
  * */
-void LastStepS(vector<Bucket>& buckets, vector<SuffixType>& types, string& input) {
-  for (int i = 0; i < (int)buckets.size(); i++) {
-    buckets[i].ResetTailPointer();
-  }
-  
-  for (int i = (int)buckets.size() - 1; i >= 0; i--) {
-    for (int j = (int)buckets.at(i).elements.size() - 1; j >= 0; j--) {
-      BucketElement element = buckets.at(i).elements.at(j);
-      int index = element.suffix_index - 1;
-      if (index >= 0 && types.at(index) != kL) {
-        Bucket& bucket = GetBucket(buckets, input.at(index));
-        if (bucket.tail == (int)bucket.elements.size()-1) {
-          // there's no kS 's in this bucket yet
-          BucketElement elem(index, types.at(index), 0);
-          bucket.PutBack(elem);
-          UpdateBorderToLeft(bucket.tail+1, bucket, types, input);
-        } else {
-          // there are kS 's in this bucket
-          InsertNotFirstS(index, buckets, bucket, types, input);
-          UpdateBorderToLeft(bucket.tail+1, bucket, types, input);
-          UpdateBorderToLeft(bucket.tail+2, bucket, types, input);
-        }
+template<class Index>
+void LastStepS(BucketArray<Index>& buckets, const SuffixTypes& types, const Text& input, LcpMinima<Index>& minima) {
+  foreach(Bucket<Index>, buckets.buckets) {
+    it->ResetTailPointer();
+  }
+  
+  minima.Reset(buckets.buckets.size());
+  
+  for (Index j = (Index)buckets.suffixes.size() - 1; j >= 0; j--) {
+    Index index = buckets.suffixes[j] - 1;
+    if (index >= 0 && types.IsS(index)) {
+      Bucket<Index>& bucket = GetBucket(buckets, input.at(index));
+      if (bucket.tail == bucket.end - 1) {
+        // there's no kS 's in this bucket yet
+        buckets.PutBack(bucket, index, 0);
+        minima.Induce(bucket.id);
+      } else {
+        // there are kS 's in this bucket
+        InsertNotFirstS(index, buckets, bucket, minima, input);
+      }
+      if (bucket.tail + 1 == bucket.head) {
+        // all S suffixes of the bucket are in
+        UpdateBorder(bucket.head, buckets, bucket, input);
       }
     }
+    
+    // the scanned element's lcp is final only after the insertion, which
+    // may have updated it
+    minima.Scan(buckets.lcps[j]);
   }
 }
 
+/*
+ * Adds the time since 'clock' to the phase time, and restarts the clock.
+ */
+void Lap(long long& phase, long long& clock) {
+  long long now = Nanoseconds();
+  phase += now - clock;
+  clock = now;
+}
+
 /* Algorithm step 4.
- * - Performs insertion of L, and S/S* suffixes into buckets, while
- * updating their lcp values. Returns list of buckets with final lcp
- * values calculated.
+ * - Performs insertion of L, and S/S* suffixes into the emptied buckets,
+ * while updating their lcp values. When done, the buckets hold the final
+ * lcp values.
  * */
-vector<Bucket> CalculateLCPStep(vector<Name>& names, vector<SuffixType>& types, string& input) {
-  vector<Bucket> buckets = CreateBuckets(input);
+template<class Index>
+void CalculateLCPStep(BucketArray<Index>& buckets, vector<Name<Index> >& names, const SuffixTypes& types, const Text& input, LcpMinima<Index>& minima, PhaseTimes& times, long long& clock) {
+  buckets.Reset();
   
   LastStepSStar(buckets, names, types, input);
+  Lap(times.last_s_star, clock);
   
   log("==== 4.1) ====\n");
-  foreach(Bucket, buckets) {
-    it->Print();
-  }
+  buckets.Print(types);
   
-  LastStepL(buckets, types, input);
+  LastStepL(buckets, types, input, minima);
+  Lap(times.last_l, clock);
   
   log("==== 4.2) ====\n");
-  foreach(Bucket, buckets) {
-    it->Print();
-  }
-  
-  LastStepS(buckets, types, input);
+  buckets.Print(types);
   
-  return buckets;
+  LastStepS(buckets, types, input, minima);
+  Lap(times.last_s, clock);
 }
 
 vector<int> BruteForce(string& input);
+vector<int> BruteForceSuffixArray(string& input);
 void Test1();
+template<class Index, class Output>
+void Construct(const Text& input, Output* sa, Output* lcp, Output* isa, PhaseTimes* times);
+template<class Index, class Output>
+void Construct(const Text& input, Output* sa, Output* lcp, Output* isa, PhaseTimes* times, Workspace<Index>& workspace);
 
 /*
  * Returns true if lists a and b are identical, otherwise false.
@@ -731,6 +947,43 @@ string RandomString(int minSize, int maxSize) {
   return ret;
 }
 
+/*
+ * Returns true if the verifier accepts, among all permutations of the
+ * suffix array of every {a, b} string of up to 'length' letters followed
+ * by '$', exactly the sorted one, each given with the lcps of its
+ * neighbouring suffixes.
+ */
+bool VerifierRejectsWrongArrays(int length) {
+  for (int size = 0; size <= length; size++) {
+    for (int bits = 0; bits < (1 << size); bits++) {
+      string input;
+      for (int k = 0; k < size; k++) {
+        input += (bits >> k) & 1 ? 'b' : 'a';
+      }
+      input += "$";
+      const Text text(input);
+      vector<int> expected_sa = BruteForceSuffixArray(input);
+      vector<int> sa(input.length()), lcp(input.length());
+      for (int k = 0; k < (int)sa.size(); k++) {
+        sa[k] = k;
+      }
+      do {
+        for (int k = 0; k < (int)sa.size(); k++) {
+          lcp[k] = k == 0 ? 0 : Lcp(sa[k-1], sa[k], text);
+        }
+        string error;
+        if (VerifySuffixArrayLCP(text, &sa[0], &lcp[0], error) != AreSame(sa, expected_sa)) {
+          cout << input << endl;
+          printf("sa:  "); Print(sa);
+          printf("lcp: "); Print(lcp);
+          return false;
+        }
+      } while (next_permutation(sa.begin(), sa.end()));
+    }
+  }
+  return true;
+}
+
 /*
  * Runs tests with random strings.
  */
@@ -741,11 +994,116 @@ void BatchTest() {
   int wrongs = 0;
   srand(time(NULL));
   
+  printf("verifier on all suffix array permutations: %s\n", VerifierRejectsWrongArrays(6) ? "ok" : "failed");
+  
+  // inputs of more than 2^31 characters don't fit here, so the buckets of
+  // the 64-bit engine are placed for letter counts past 2^31 alone
+  const long long wide_count = 3LL << 30;
+  long long wide_counts[256] = {0};
+  wide_counts[(unsigned char)'$'] = 1;
+  wide_counts[(unsigned char)'a'] = wide_count;
+  wide_counts[(unsigned char)'c'] = wide_count;
+  BucketArray<long long> wide_buckets;
+  wide_buckets.Place(wide_counts, true, '$');
+  const vector<Bucket<long long> >& wide = wide_buckets.buckets;
+  printf("64-bit bucket offsets: %s\n", wide.size() == 3 && wide[0].end == 1 &&
+      wide[1].begin == 1 && wide[1].end == 1 + wide_count && wide[2].begin == 1 + wide_count &&
+      wide[2].end == 1 + 2 * wide_count && wide[2].tail == 2 * wide_count ? "ok" : "failed");
+  
+  // the sentinel sorts first whatever the other bytes are, including ones
+  // below '$', '$' itself, and bytes of 0x80 and above, which are negative
+  // chars, so all engines and an implicit sentinel must agree on them
+  string bytes = RandomString(size, size);
+  for (size_t k = 0; k < bytes.length(); k += 3) {
+    bytes[k] = (char)(1 + rand() % 255);
+  }
+  bytes += "$";
+  vector<int> bytes_sa = BruteForceSuffixArray(bytes), bytes_lcp = BruteForce(bytes);
+  bool bytes_same = true;
+  string bytes_error;
+  const LcpEngine all_engines[] = {kInducingEngine, kKasaiEngine, kPhiEngine};
+  for (int e = 0; e < 3; e++) {
+    for (int implicit = 0; implicit < 2; implicit++) {
+      const Text text = implicit ? SentinelText(bytes.data(), bytes.length() - 1) : Text(bytes);
+      vector<int> engine_sa(bytes.length()), engine_lcp(bytes.length());
+      CalculateSuffixArrayLCP(text, &engine_sa[0], &engine_lcp[0], all_engines[e]);
+      bytes_same = bytes_same && AreSame(engine_sa, bytes_sa) && AreSame(engine_lcp, bytes_lcp) &&
+          VerifySuffixArrayLCP(text, &engine_sa[0], &engine_lcp[0], bytes_error) &&
+          VerifyLCP(text, &engine_lcp[0], bytes_error);
+    }
+  }
+  printf("arbitrary bytes: %s %s\n", bytes_same ? "ok" : "failed", bytes_error.c_str());
+  
+  // repetitive inputs have many equal S* names and long runs, so the S*
+  // lcps come from the reduced string and the borders from long runs
+  bool repetitive_same = true;
+  string repetitive_error;
+  string fibonacci = "a", next = "ab";
+  while (next.length() < 2000) {
+    string longer = next + fibonacci;
+    fibonacci = next;
+    next = longer;
+  }
+  const string period = RandomString(1, 30);
+  string repetitive[] = {next, "", string(500, 'a') + "b" + string(700, 'a'), ""};
+  while (repetitive[1].length() < 2000) {
+    repetitive[1] += period;
+  }
+  for (int k = 0; k < 100; k++) {
+    repetitive[3] += string(1 + rand() % 40, 'a' + rand() % 3);
+  }
+  for (int k = 0; k < 4; k++) {
+    string input = repetitive[k] + "$";
+    vector<int> repetitive_sa(input.length()), repetitive_lcp(input.length());
+    CalculateSuffixArrayLCP(input, &repetitive_sa[0], &repetitive_lcp[0], NULL);
+    vector<int> expected_sa = BruteForceSuffixArray(input), expected_lcp = BruteForce(input);
+    repetitive_same = repetitive_same && AreSame(repetitive_sa, expected_sa) && AreSame(repetitive_lcp, expected_lcp) &&
+        VerifySuffixArrayLCP(input, &repetitive_sa[0], &repetitive_lcp[0], repetitive_error);
+  }
+  printf("repetitive inputs: %s %s\n", repetitive_same ? "ok" : "failed", repetitive_error.c_str());
+  
   for (int i = 0; i < t; i++) {
     string input = RandomString(size, size) + "$";
     vector<int> actual = CalculateLCP(input);
     vector<int> expected = BruteForce(input);
-    if (AreSame(actual, expected)) {
+    
+    vector<int> actual_sa(input.length()), actual_lcp(input.length());
+    CalculateSuffixArrayLCP(input, &actual_sa[0], &actual_lcp[0], NULL);
+    vector<int> expected_sa = BruteForceSuffixArray(input);
+    
+    // the API only runs the 64-bit engine on long inputs, so it's tested
+    // directly
+    vector<long long> wide_sa(input.length()), wide_lcp(input.length());
+    Construct<long long>(input, &wide_sa[0], &wide_lcp[0], (long long*)NULL, NULL);
+    bool wide_same = equal(wide_sa.begin(), wide_sa.end(), expected_sa.begin()) &&
+        equal(wide_lcp.begin(), wide_lcp.end(), expected.begin());
+    
+    bool engines_same = true;
+    const LcpEngine engines[] = {kKasaiEngine, kPhiEngine};
+    for (int e = 0; e < 2; e++) {
+      vector<int> engine_sa(input.length()), engine_lcp(input.length());
+      CalculateSuffixArrayLCP(input, &engine_sa[0], &engine_lcp[0], engines[e]);
+      engines_same = engines_same && AreSame(engine_sa, expected_sa) && AreSame(engine_lcp, expected);
+    }
+    
+    SuccinctLcp succinct(&actual_sa[0], &actual_lcp[0], input.length());
+    bool succinct_same = true;
+    for (int k = 0; k < (int)input.length(); k++) {
+      succinct_same = succinct_same && (int)succinct.Lcp(k, &actual_sa[0]) == expected[k];
+    }
+    
+    // the verifier accepts the results, and rejects them with two
+    // neighbouring suffixes swapped
+    string error;
+    bool verified = VerifySuffixArrayLCP(input, &actual_sa[0], &actual_lcp[0], error) &&
+        VerifyLCP(input, &actual[0], error);
+    const int swapped = rand() % (input.length() - 1);
+    swap(actual_sa[swapped], actual_sa[swapped + 1]);
+    verified = verified && !VerifySuffixArrayLCP(input, &actual_sa[0], &actual_lcp[0], error);
+    swap(actual_sa[swapped], actual_sa[swapped + 1]);
+    
+    if (AreSame(actual, expected) && AreSame(actual_lcp, expected) && AreSame(actual_sa, expected_sa) && wide_same &&
+        engines_same && succinct_same && verified) {
       correct++;
     } else {
       wrongs++;
@@ -762,53 +1120,190 @@ void BatchTest() {
 }
 
 /*
- * 
+ * Runs the construction with Index as the type of all indices and lcps,
+ * and writes the results as Output. The input must fit into Index.
  */
-vector<int> CalculateLCP(string& input) {
-  vector<Bucket> buckets = CreateBuckets(input);
-  vector<SuffixType> types = CreateSuffixTypeArray(input);
+template<class Index, class Output>
+void Construct(const Text& input, Output* sa, Output* lcp, Output* isa, PhaseTimes* times) {
+  Workspace<Index> workspace;
+  Construct(input, sa, lcp, isa, times, workspace);
+}
+
+/*
+ * Same, in the buffers of the workspace.
+ */
+template<class Index, class Output>
+void Construct(const Text& input, Output* sa, Output* lcp, Output* isa, PhaseTimes* times, Workspace<Index>& workspace) {
+  PhaseTimes unused_times;
+  PhaseTimes& phase = times != NULL ? *times : unused_times;
+  long long clock = Nanoseconds();
+  
+  // a lone sentinel has no S* suffix to sort the others from
+  if (input.length() <= 1) {
+    for (Index i = 0; i < (Index)input.length(); i++) {
+      if (sa != NULL) {
+        sa[i] = 0;
+      }
+      if (lcp != NULL) {
+        lcp[i] = 0;
+      }
+      if (isa != NULL) {
+        isa[i] = 0;
+      }
+    }
+    return;
+  }
+  
+  BucketArray<Index>& buckets = workspace.buckets;
+  buckets.Layout(input);
+  Lap(phase.buckets, clock);
+  SuffixTypes& types = workspace.types;
+  CreateSuffixTypeArray(input, types);
+  Lap(phase.types, clock);
   
   AddSStarSuffix(buckets, types, input);
+  Lap(phase.s_star, clock);
   
   log("==== 1. ====\n");
-  foreach(Bucket, buckets) {
-    it->Print();
-  }
+  buckets.Print(types);
   
   AddLSuffixes(buckets, types, input);
   
   log("==== 2. ====\n");
-  foreach(Bucket, buckets) {
-    it->Print();
-  }
+  buckets.Print(types);
   
   AddSSuffixes(buckets, types, input);
+  Lap(phase.induction, clock);
   
   log("==== 3. ====\n");
-  foreach(Bucket, buckets) {
-    it->Print();
-  }
+  buckets.Print(types);
   
-  vector<Name> unsorted_names = GetNames(buckets, types, input);
-  vector<Names> categories = GetCategories(unsorted_names);
-  vector<Name> names = Flatten(categories, input);
-  LcpInitial(names, input);
-  buckets = CalculateLCPStep(names, types, input);
+  GetNames(buckets, types, input, workspace.names);
+  vector<Name<Index> >& names = SortNames(workspace.names, types, input, workspace);
+  Lap(phase.naming, clock);
+  CalculateLCPStep(buckets, names, types, input, workspace.minima, phase, clock);
   
   log("==== final ====\n");
-  foreach(Bucket, buckets) {
-    it->Print();
-  }
+  buckets.Print(types);
   
-  vector<int> result;
-  for (vector<Bucket>::iterator it = buckets.begin(); it != buckets.end(); ++it) {
-    for (int i = 0; i < (int)it->elements.size(); i++) {
-      result.push_back(it->elements[i].lcp);
+  if (sa != NULL) {
+    copy(buckets.suffixes.begin(), buckets.suffixes.end(), sa);
+  }
+  if (lcp != NULL) {
+    copy(buckets.lcps.begin(), buckets.lcps.end(), lcp);
+  }
+  if (isa != NULL) {
+    for (Index i = 0; i < (Index)buckets.suffixes.size(); i++) {
+      isa[buckets.suffixes[i]] = i;
     }
   }
+  Lap(phase.output, clock);
+}
+
+/*
+ * Calculates the suffix array, the LCP array and the inverse suffix array
+ * for the given input string in one run. Results are written to the given
+ * buffers of input.length() elements; NULL buffers are skipped. If times is
+ * given, time spent in each phase is added to it. Throws if the input is
+ * longer than kMaxInt32Length.
+ */
+void CalculateSuffixArrayLCP(const Text& input, int* sa, int* lcp, int* isa, PhaseTimes* times) {
+  if ((long long)input.length() > kMaxInt32Length) {
+    throw string("Input too long for 32-bit results, use 64-bit buffers");
+  }
+  Construct<int>(input, sa, lcp, isa, times);
+}
+
+/*
+ * Same, with 64-bit results, for inputs of any length. Inputs that fit into
+ * 32 bits still run with 32-bit indices, which takes about half the memory.
+ */
+void CalculateSuffixArrayLCP(const Text& input, long long* sa, long long* lcp, long long* isa, PhaseTimes* times) {
+  if ((long long)input.length() <= kMaxInt32Length) {
+    Construct<int>(input, sa, lcp, isa, times);
+  } else {
+    Construct<long long>(input, sa, lcp, isa, times);
+  }
+}
+
+/*
+ * Calculates the LCP array for the given input string.
+ */
+vector<int> CalculateLCP(const Text& input) {
+  vector<int> result(input.length());
+  CalculateSuffixArrayLCP(input, NULL, &result[0], NULL);
   return result;
 }
 
+LcpContext::LcpContext() {
+  workspace = new Workspace<int>();
+}
+
+LcpContext::~LcpContext() {
+  delete workspace;
+}
+
+/*
+ * Same as CalculateSuffixArrayLCP, in the buffers of the context.
+ */
+void CalculateSuffixArrayLCP(const Text& input, int* sa, int* lcp, LcpContext& context, PhaseTimes* times) {
+  if ((long long)input.length() > kMaxInt32Length) {
+    throw string("Input too long for 32-bit results, use 64-bit buffers");
+  }
+  Construct<int>(input, sa, lcp, (int*)NULL, times, *context.workspace);
+}
+
+/*
+ * Calculates the LCP array for the given input string into the result,
+ * in the buffers of the context.
+ */
+void CalculateLCP(const Text& input, LcpContext& context, vector<int>& result) {
+  result.resize(input.length());
+  CalculateSuffixArrayLCP(input, NULL, &result[0], context);
+}
+
+/*
+ * Calculates the generalized suffix array and LCP array of an input made of
+ * several records, separated by kSeparator. All separators are the same
+ * character, so a common prefix can run over one; with distinct separators
+ * it would stop there, so each lcp is cut at the distance from its suffix to
+ * the end of its record. Documents are assigned in one pass over the text,
+ * through the inverse suffix array.
+ */
+template<class Output>
+void Generalize(const Text& input, Output* sa, Output* lcp, Output* documents) {
+  const long long n = input.length();
+  vector<Output> isa(n);
+  CalculateSuffixArrayLCP(input, sa, lcp, &isa[0]);
+  
+  Output document = 0;
+  for (long long i = 0; i < n; i++) {
+    documents[isa[i]] = document;
+    if (input[i] == kSeparator) {
+      document++;
+    }
+  }
+  
+  long long end = n - 1;
+  for (long long i = n - 1; i >= 0; i--) {
+    if (input[i] == kSeparator) {
+      end = i;
+    }
+    Output& value = lcp[isa[i]];
+    if (value > end - i) {
+      value = end - i;
+    }
+  }
+}
+
+void CalculateGeneralizedSuffixArrayLCP(const Text& input, int* sa, int* lcp, int* documents) {
+  Generalize(input, sa, lcp, documents);
+}
+
+void CalculateGeneralizedSuffixArrayLCP(const Text& input, long long* sa, long long* lcp, long long* documents) {
+  Generalize(input, sa, lcp, documents);
+}
+
 /*
  * Single input test.
  */
@@ -835,44 +1330,35 @@ struct SuffixComparator {
   SuffixComparator(string& in) : input(in) {}
   
   bool operator()(const int& a, const int& b) {
-    int i = a;
-    int j = b;
-    int k = 0;
-    while (i+k < (int)input.length() && j+k < (int)input.length()) {
-      if (input.at(i+k) < input.at(j+k)) {
-        return true;
-      } else if (input.at(i+k) > input.at(j+k)) {
-        return false;
-      }
-      k++;
+    if (a == b) {
+      return false;
+    }
+    const int n = input.length();
+    int k = CommonPrefix(input.data() + a, input.data() + b, n - 1 - max(a, b));
+    if (a + k == n - 1) {
+      return true;
+    }
+    if (b + k == n - 1) {
+      return false;
     }
-    return true;
+    return input[a+k] < input[b+k];
   }
 };
 
 /*
  * Calculates the LCP value between suffixes with indicies a and b.
  */ 
-int Lcp(int a, int b, string& input) {
-  int i = a;
-  int j = b;
-  int k = 0;
-  int lcp = 0;
-  while (i+k < (int)input.length() && j+k < (int)input.length()) {
-    if (input.at(i+k) == input.at(j+k)) {
-      lcp++;
-    } else {
-      break;
-    }
-    k++;
-  }
+long long Lcp(long long a, long long b, const Text& input) {
+  long long len = input.length() - max(a, b);
+  long long lcp = TextCommonPrefix(input, a, b, len);
+  COUNT(lcp_chars, lcp < len ? lcp + 1 : lcp);
   return lcp;
 }
 
 /*
- * Brute-force solution, for testing purposes.
+ * Brute-force suffix array, for testing purposes.
  */
-vector<int> BruteForce(string& input) {
+vector<int> BruteForceSuffixArray(string& input) {
   SuffixComparator cmp(input);
   
   vector<int> v;
@@ -881,6 +1367,14 @@ vector<int> BruteForce(string& input) {
   }
   
   sort(v.begin(), v.end(), cmp);
+  return v;
+}
+
+/*
+ * Brute-force solution, for testing purposes.
+ */
+vector<int> BruteForce(string& input) {
+  vector<int> v = BruteForceSuffixArray(input);
   
   vector<int> result;
   result.push_back(0);
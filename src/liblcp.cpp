@@ -0,0 +1,16 @@
+#include <vector>
+using namespace std;
+
+#include "liblcp.h"
+
+void CalculateSuffixArrayLCP(const uint8_t *data, size_t n, int* sa, int* lcp, LcpEngine engine) {
+  CalculateSuffixArrayLCP(BufferText(data, n), sa, lcp, engine);
+}
+
+void CalculateSuffixArrayLCP(const uint8_t *data, size_t n, long long* sa, long long* lcp, LcpEngine engine) {
+  CalculateSuffixArrayLCP(BufferText(data, n), sa, lcp, engine);
+}
+
+vector<int> CalculateLCP(const uint8_t *data, size_t n) {
+  return CalculateLCP(BufferText(data, n));
+}
@@ -1,56 +1,596 @@
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <ostream>
 #include <ctime>
+#include <memory>
 using namespace std;
 
 #include "lcp.h"
+#include "input.h"
+#include "output.h"
+#include "options.h"
+#include "bench.h"
+#include "batch.h"
+#include "counters.h"
+#include "external.h"
+#include "timer.h"
+#include "verify.h"
+#include "repeats.h"
+#include "index.h"
+#include "service.h"
+
+/*
+ * Returns <directory>/<name><i>.<extension of the format>.
+ */
+string OutputFilename(const char *directory, const char *name, int i, Options& options) {
+	char filename[1024];
+	snprintf(filename, sizeof(filename), "%s/%s%d.%s", directory, name, i, OutputExtension(options.format));
+	return filename;
+}
+
+/*
+ * Returns <directory>/<name><i>.txt.
+ */
+string TextFilename(const char *directory, const char *name, int i) {
+	char filename[1024];
+	snprintf(filename, sizeof(filename), "%s/%s%d.txt", directory, name, i);
+	return filename;
+}
+
+/*
+ * Reads a file written in the given format and prints its values.
+ */
+int Decode(const char *filename, Options& options) {
+	vector<long long> values;
+	if (!ReadValues(filename, values, options.format)) {
+		printf("Could not read %s\n", filename);
+		return 1;
+	}
+	for (size_t i = 0; i < values.size(); i++) {
+		printf("%lld ", values[i]);
+	}
+	printf("\n");
+	return 0;
+}
+
+/*
+ * Reads the input file the way the options say: memory-mapped as FASTA/FASTQ
+ * records or as text, or read up to the first whitespace, and then packed 2
+ * bits per base with --dna, in which case the bytes are freed. The text is
+ * held by line, mapped or dna. Returns false if the file can't be opened,
+ * throws on malformed FASTA/FASTQ input.
+ */
+bool LoadInput(const char *filename, Options& options, string& line, MappedFile& mapped, vector<Record>& records,
+		unique_ptr<PackedDna>& dna, Text& input) {
+	if (options.fasta) {
+		if (!mapped.Open(filename)) {
+			return false;
+		}
+		input = MappedRecords(mapped, records);
+	} else if (options.use_mmap) {
+		if (!mapped.Open(filename)) {
+			return false;
+		}
+		input = MappedText(mapped, options.newlines);
+	} else {
+		if (!ReadInput(filename, line)) {
+			return false;
+		}
+		input = Text(line);
+	}
+	
+	if (options.dna) {
+		dna.reset(new PackedDna(input.data, input.length()));
+		input = Text(*dna);
+		string().swap(line);
+		mapped.Close();
+	}
+	return true;
+}
 
 /*
  * Runs the algorithm on input(1,2,3...).txt files from the specified directory,
- * and outputs the solutions to the same directory, to output(1,2,3...).txt files.
+ * and outputs the solutions to the same directory, to output(1,2,3...).txt files
+ * (or another extension, depending on the output format).
+ * Input files are either read up to the first whitespace, or memory-mapped
+ * whole, depending on the options. FASTA/FASTQ inputs give one generalized
+ * index over all their records, and the record of every suffix array slot
+ * is written to document(1,2,3...).txt files.
  */
-void Run(const char *directory) {
+void Run(const char *directory, Options& options) {
 	int i = 1;
-	char filename[32];
+	char filename[1024];
 	
 	while (true) {
-		sprintf(filename, "%s/input%d.txt", directory, i);
+		snprintf(filename, sizeof(filename), "%s/input%d.txt", directory, i);
 		printf("%s\n", filename);
 		
-		ifstream file (filename, ifstream::in);
-		if (!file.good()) {
+		string line;
+		MappedFile mapped;
+		Text input(line);
+		vector<Record> records;
+		unique_ptr<PackedDna> dna;
+		try {
+			if (!LoadInput(filename, options, line, mapped, records, dna, input)) {
+				break;
+			}
+		} catch (string e) {
+			printf("%s: %s\n", filename, e.c_str());
 			break;
 		}
+		if (options.fasta) {
+			printf("Records: %d\n", (int)records.size());
+		}
+		if (options.dna) {
+			printf("Packed: %lu bytes, %lu exceptions\n", (unsigned long)dna->Bytes(),
+					(unsigned long)dna->exception_positions.size());
+		}
 		
-		string line;
-		file >> line;
-		file.close();
+		printf("File: %s\nInput length: %lld\n", filename, (long long)input.length());
+		if (!options.fasta) {
+			LcpEngine engine = options.engine == kAutoEngine ? DefaultLcpEngine() : options.engine;
+			printf("Engine: %s\n", LcpEngineName(engine));
+		}
+		printf("Calculating lcp...\n");
+		long timeNow = time(NULL);
+		ResetOperationCounts();
+		string error;
+		if (!IndexAndWrite(input, options, OutputFilename(directory, "output", i, options),
+				OutputFilename(directory, "document", i, options), error)) {
+			printf("%s\n", error.c_str());
+		}
+		printf("Time elapsed: %ld [sec]\n", time(NULL) - timeNow);
+		PrintOperationCounts(input.length());
+		printf("\n");
+		mapped.Close();
+		i++;
+	}
+}
+
+/*
+ * Runs the external construction on input(1,2,3...).txt files from the
+ * specified directory, within the memory budget, and streams the LCP arrays
+ * to output(1,2,3...).txt and the suffix arrays to sa(1,2,3...).txt files
+ * (or other extensions, depending on the output format).
+ */
+void RunExternal(const char *directory, Options& options, size_t memory_budget) {
+	char filename[1024];
+	
+	for (int i = 1; ; i++) {
+		snprintf(filename, sizeof(filename), "%s/input%d.txt", directory, i);
+		FILE *file = fopen(filename, "rb");
+		if (file == NULL) {
+			break;
+		}
+		fclose(file);
+		printf("%s\nMemory budget: %lu MB\nCalculating suffix array and lcp...\n", filename,
+				(unsigned long)(memory_budget >> 20));
 		
-		printf("File: %s\nInput length: %d\nCalculating lcp...\n", filename, (int)line.length());
 		long timeNow = time(NULL);
-		vector<int> output = CalculateLCP(line);
-		printf("Time elapsed: %ld [sec]\n\n", time(NULL) - timeNow);
+		ExternalStats stats;
+		string error;
+		if (!ExternalSuffixArrayLCP(filename, options, memory_budget, OutputFilename(directory, "sa", i, options),
+				OutputFilename(directory, "output", i, options), stats, error)) {
+			printf("%s\n", error.c_str());
+		}
+		printf("Time elapsed: %ld [sec]\n", time(NULL) - timeNow);
+		PrintExternalStats(stats);
+		printf("\n");
+	}
+}
+
+/*
+ * Checks the output(1,2,3...) files of the specified directory against the
+ * input(1,2,3...).txt files, read the same way as by Run, together with the
+ * sa(1,2,3...) files where they exist (external mode writes them). Prints
+ * the first mismatch of every output that fails, and returns the number of
+ * failed outputs.
+ */
+int VerifyOutputs(const char *directory, Options& options) {
+	int failed = 0;
+	char filename[1024];
+	
+	for (int i = 1; ; i++) {
+		snprintf(filename, sizeof(filename), "%s/input%d.txt", directory, i);
+		string line;
+		MappedFile mapped;
+		Text input(line);
+		vector<Record> records;
+		unique_ptr<PackedDna> dna;
+		if (!LoadInput(filename, options, line, mapped, records, dna, input)) {
+			break;
+		}
 		
-		string out;
-		char num[16];
-		for (int j = 0; j < (int)output.size(); j++) {
-			sprintf(num, "%d", output[j]);
-			out += num;
-			out += " ";
+		string sa_filename = OutputFilename(directory, "sa", i, options);
+		FILE *sa_file = fopen(sa_filename.c_str(), "rb");
+		if (sa_file == NULL) {
+			sa_filename.clear();
+		} else {
+			fclose(sa_file);
 		}
+		string lcp_filename = OutputFilename(directory, "output", i, options);
 		
-		sprintf(filename, "%s/output%d.txt", directory, i);
-		ofstream outFile (filename, ofstream::out);
-		outFile << out;
-		outFile.close();
-		i++;
+		long long clock = Nanoseconds();
+		string error;
+		bool ok = VerifyFiles(input, sa_filename, lcp_filename, options.format, error);
+		printf("%s: %s (%lld characters, %s, %.1f ms)\n", lcp_filename.c_str(), ok ? "ok" : error.c_str(),
+				(long long)input.length(), sa_filename.empty() ? "suffix array rebuilt" : "with suffix array",
+				(Nanoseconds() - clock) / 1e6);
+		if (!ok) {
+			failed++;
+		}
+		mapped.Close();
 	}
+	return failed;
+}
+
+/*
+ * Writes the repeats or the spectrum with the writer to the file, returns
+ * false if it can't be written.
+ */
+template<class Values>
+bool WriteAnalysisFile(const string& filename, const Values& values, void (*writer)(FILE *, const Values&)) {
+	FILE *file = fopen(filename.c_str(), "w");
+	if (file == NULL) {
+		return false;
+	}
+	writer(file, values);
+	return fclose(file) == 0;
+}
+
+/*
+ * Analyzes the repeats of the input(1,2,3...).txt files from the specified
+ * directory, read the same way as by Run: prints the longest repeat and
+ * the numbers of maximal and supermaximal repeats of at least the query's
+ * minimum length, and writes them to repeats(1,2,3...).txt and
+ * supermaximal(1,2,3...).txt files as lines of "length count position",
+ * and the k-mer spectrum, if asked for, to kmers(1,2,3...).txt files as
+ * lines of "frequency k-mers". Returns non-zero on failure.
+ */
+int RunRepeats(const char *directory, Options& options, RepeatQuery& query) {
+	char filename[1024];
+	query.keep_maximal = query.keep_supermaximal = true;
+	query.generalized = options.fasta;
+	
+	for (int i = 1; ; i++) {
+		snprintf(filename, sizeof(filename), "%s/input%d.txt", directory, i);
+		string line;
+		MappedFile mapped;
+		Text input(line);
+		vector<Record> records;
+		unique_ptr<PackedDna> dna;
+		try {
+			if (!LoadInput(filename, options, line, mapped, records, dna, input)) {
+				break;
+			}
+		} catch (string e) {
+			printf("%s: %s\n", filename, e.c_str());
+			return 1;
+		}
+		printf("%s\nInput length: %lld\n", filename, (long long)input.length());
+		
+		long long clock = Nanoseconds();
+		RepeatAnalysis analysis;
+		IndexAndAnalyzeRepeats(input, options.engine, query, analysis);
+		
+		const Repeat& longest = analysis.longest;
+		string prefix;
+		for (long long k = 0; k < min(longest.length, 60LL); k++) {
+			prefix += input[longest.position + k];
+		}
+		printf("Longest repeat: %lld characters, %lld occurrences, at %lld: %s%s\n", longest.length,
+				longest.count, longest.position, prefix.c_str(), longest.length > 60 ? "..." : "");
+		
+		string maximal_filename = TextFilename(directory, "repeats", i);
+		string supermaximal_filename = TextFilename(directory, "supermaximal", i);
+		string kmers_filename = TextFilename(directory, "kmers", i);
+		printf("Maximal repeats of at least %lld characters: %lld, in %s\n", query.min_length,
+				analysis.maximal_count, maximal_filename.c_str());
+		printf("Supermaximal repeats: %lld, in %s\n", analysis.supermaximal_count, supermaximal_filename.c_str());
+		bool written = WriteAnalysisFile(maximal_filename, analysis.maximal, WriteRepeats) &&
+				WriteAnalysisFile(supermaximal_filename, analysis.supermaximal, WriteRepeats);
+		if (query.kmer_length > 0) {
+			long long distinct = 0;
+			for (map<long long, long long>::iterator it = analysis.spectrum.begin(); it != analysis.spectrum.end(); ++it) {
+				distinct += it->second;
+			}
+			printf("Distinct %lld-mers: %lld, spectrum in %s\n", query.kmer_length, distinct, kmers_filename.c_str());
+			written = written && WriteAnalysisFile(kmers_filename, analysis.spectrum, WriteSpectrum);
+		}
+		if (!written) {
+			printf("Could not write the results\n");
+			return 1;
+		}
+		printf("Time elapsed: %.2f [sec]\n\n", (Nanoseconds() - clock) / 1e9);
+	}
+	return 0;
+}
+
+/*
+ * Builds index(1,2,3...).idx files of the input(1,2,3...).txt files from
+ * the specified directory, read the same way as by Run. Indexes that are
+ * up to date with their input are kept. Returns the number of failed
+ * inputs.
+ */
+int RunIndex(const char *directory, Options& options) {
+	int failed = 0;
+	char filename[1024];
+	
+	for (int i = 1; ; i++) {
+		snprintf(filename, sizeof(filename), "%s/input%d.txt", directory, i);
+		string line;
+		MappedFile mapped;
+		Text input(line);
+		vector<Record> records;
+		unique_ptr<PackedDna> dna;
+		if (!LoadInput(filename, options, line, mapped, records, dna, input)) {
+			break;
+		}
+		
+		char index_filename[1024];
+		snprintf(index_filename, sizeof(index_filename), "%s/index%d.idx", directory, i);
+		long long clock = Nanoseconds();
+		bool reused;
+		string error;
+		if (!BuildIndex(input, options.engine, index_filename, reused, error)) {
+			printf("%s: %s\n", index_filename, error.c_str());
+			failed++;
+			continue;
+		}
+		printf("%s: %s (%lld characters, %.2f ms)\n", index_filename, reused ? "up to date" : "built",
+				(long long)input.length(), (Nanoseconds() - clock) / 1e6);
+	}
+	return failed;
+}
+
+/*
+ * Opens the index file, prints its header and how long opening and
+ * checking the checksums take. Returns non-zero on failure.
+ */
+int LoadIndex(const char *filename) {
+	LcpIndex index;
+	string error;
+	long long clock = Nanoseconds();
+	if (!index.Open(filename, error)) {
+		printf("%s: %s\n", filename, error.c_str());
+		return 1;
+	}
+	const long long opened = Nanoseconds() - clock;
+	printf("%s: version %u, %llu characters, %u-byte values, %llu bytes, opened in %.3f ms\n", filename,
+			index.header.version, (unsigned long long)index.length(), index.header.index_bytes,
+			(unsigned long long)index.header.file_bytes, opened / 1e6);
+	
+	clock = Nanoseconds();
+	if (!index.VerifyChecksums(error)) {
+		printf("%s: %s\n", filename, error.c_str());
+		return 1;
+	}
+	printf("Checksums ok in %.2f ms\n", (Nanoseconds() - clock) / 1e6);
+	return 0;
+}
+
+/*
+ * Loads the index file and serves count and locate queries from stdin, or
+ * from connections to the Unix socket if one is given, with the threads.
+ * Prints the queries per second when the input ends. Returns non-zero on
+ * failure.
+ */
+int Serve(const char *filename, const char *socket_path, int threads) {
+	LcpIndex index;
+	string error;
+	long long clock = Nanoseconds();
+	if (!index.Open(filename, error)) {
+		fprintf(stderr, "%s: %s\n", filename, error.c_str());
+		return 1;
+	}
+	fprintf(stderr, "Loaded %s: %llu characters in %.3f ms, %d threads\n", filename,
+			(unsigned long long)index.length(), (Nanoseconds() - clock) / 1e6, threads);
+	
+	ServiceStats stats;
+	if (socket_path != NULL) {
+		fprintf(stderr, "Listening on %s\n", socket_path);
+		if (!ServeSocket(index, socket_path, threads, stats, error)) {
+			fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+		return 0;
+	}
+	bool served = ServeStream(index, 0, 1, threads, stats);
+	fprintf(stderr, "%s\n", stats.Summary().c_str());
+	return served ? 0 : 1;
+}
+
+/*
+ * Prints the usage.
+ */
+void Usage(const char *name) {
+	printf("Usage: %s [--mmap] [--newlines=filter|separate] [--fasta] [--dna] [--engine=ENGINE] [--format=FORMAT] [directory]\n", name);
+	printf("       %s [--format=FORMAT] --decode FILE\n", name);
+	printf("       %s --bench [--json=FILE] [--label=LABEL] [directory]\n", name);
+	printf("       %s [options] --batch PATH [--threads=N] [--memory=MB] [--output=DIR]\n", name);
+	printf("       %s [--format=FORMAT] --external [--memory=MB] [directory]\n", name);
+	printf("       %s [--mmap] [--newlines=filter|separate] [--dna] [--format=FORMAT] --verify [directory]\n", name);
+	printf("       %s [reading options] [--engine=ENGINE] --index [directory]\n", name);
+	printf("       %s --load FILE\n", name);
+	printf("       %s --serve FILE [--socket=PATH] [--threads=N]\n", name);
+	printf("       %s [reading options] [--engine=ENGINE] --repeats [--min-length=L] [--kmers=K] [directory]\n", name);
+	printf("  --mmap         memory-map the input files instead of reading them\n");
+	printf("  --newlines=    with --mmap, drop newlines (filter, default) or\n");
+	printf("                 turn them into '%c' separators (separate)\n", kSeparator);
+	printf("  --fasta        inputs are multi-record FASTA/FASTQ files, indexed together,\n");
+	printf("                 with records of suffix array slots in document(1,2,3...).txt\n");
+	printf("  --dna          pack inputs 2 bits per base (ACGT), other characters are\n");
+	printf("                 kept in an exception list\n");
+	printf("  --engine=      LCP engine: inducing (modified SA-IS), kasai or phi (SA-IS,\n");
+	printf("                 then Kasai's or the Phi algorithm), or auto (default), which\n");
+	printf("                 picks one by input length and repetitiveness\n");
+	printf("  --format=      output format: text (default), int32, int64 (raw\n");
+	printf("                 little-endian), packed (bytes + overflow table), varint\n");
+	printf("  --decode FILE  print the values of an output file of the given format\n");
+	printf("  --bench        time the construction phases on the inputs and on\n");
+	printf("                 synthetic texts, optionally writing JSON results\n");
+	printf("  --batch PATH   index every file of the directory PATH, or every file listed\n");
+	printf("                 in the file PATH, in parallel, largest first, writing\n");
+	printf("                 <file>.lcp.<format> next to each file or into --output=DIR\n");
+	printf("  --threads=N    batch worker threads, or threads of a single construction,\n");
+	printf("                 all cores by default\n");
+	printf("  --memory=MB    estimated memory the batch jobs may use at once, or the\n");
+	printf("                 RAM budget of --external, half of the RAM by default\n");
+	printf("  --external     build the suffix and LCP arrays of inputs larger than the\n");
+	printf("                 RAM budget by partitions, written to sa(1,2,3...) and\n");
+	printf("                 output(1,2,3...) files\n");
+	printf("  --verify       check the output(1,2,3...) files (and sa(1,2,3...) files\n");
+	printf("                 where present) against the inputs in linear time\n");
+	printf("  --index        write index(1,2,3...).idx files with the text, suffix array,\n");
+	printf("                 LCP array and buckets, to be memory-mapped by loaders\n");
+	printf("  --load FILE    open an index file and check its checksums\n");
+	printf("  --serve FILE   answer count and locate queries over the index file, read\n");
+	printf("                 from stdin or from connections to the Unix socket PATH\n");
+	printf("  --repeats      find the longest, maximal and supermaximal repeats of the\n");
+	printf("                 inputs, written to repeats(1,2,3...).txt and\n");
+	printf("                 supermaximal(1,2,3...).txt files\n");
+	printf("  --min-length=L shortest repeat counted and written, 1 by default\n");
+	printf("  --kmers=K      with --repeats, also the spectrum of K-mer frequencies,\n");
+	printf("                 written to kmers(1,2,3...).txt files\n");
+	printf("  directory      directory with input(1,2,3...).txt files, tests by default\n");
 }
 
 int main(int argc, char **argv) {
 	//BatchTest();
-	Run("tests");
+	Options options;
+	const char *directory = "tests";
+	bool bench = false;
+	const char *json = NULL;
+	const char *label = "";
+	const char *batch_path = NULL;
+	bool external = false;
+	bool verify = false;
+	bool repeats = false;
+	bool index = false;
+	const char *serve_path = NULL;
+	const char *socket_path = NULL;
+	RepeatQuery query;
+	BatchOptions batch;
+	
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--mmap") == 0) {
+			options.use_mmap = true;
+		} else if (strcmp(argv[i], "--bench") == 0) {
+			bench = true;
+		} else if (strncmp(argv[i], "--json=", 7) == 0) {
+			json = argv[i] + 7;
+		} else if (strncmp(argv[i], "--label=", 8) == 0) {
+			label = argv[i] + 8;
+		} else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+			batch_path = argv[++i];
+		} else if (strncmp(argv[i], "--threads=", 10) == 0) {
+			batch.threads = atoi(argv[i] + 10);
+			if (batch.threads < 1) {
+				Usage(argv[0]);
+				return 1;
+			}
+		} else if (strncmp(argv[i], "--memory=", 9) == 0) {
+			batch.memory_budget = (size_t)atol(argv[i] + 9) << 20;
+		} else if (strncmp(argv[i], "--output=", 9) == 0) {
+			batch.output_directory = argv[i] + 9;
+		} else if (strcmp(argv[i], "--external") == 0) {
+			external = true;
+		} else if (strcmp(argv[i], "--verify") == 0) {
+			verify = true;
+		} else if (strcmp(argv[i], "--index") == 0) {
+			index = true;
+		} else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+			return LoadIndex(argv[i+1]);
+		} else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+			serve_path = argv[++i];
+		} else if (strncmp(argv[i], "--socket=", 9) == 0) {
+			socket_path = argv[i] + 9;
+		} else if (strcmp(argv[i], "--repeats") == 0) {
+			repeats = true;
+		} else if (strncmp(argv[i], "--min-length=", 13) == 0) {
+			query.min_length = atoll(argv[i] + 13);
+		} else if (strncmp(argv[i], "--kmers=", 8) == 0) {
+			query.kmer_length = atoll(argv[i] + 8);
+			if (query.kmer_length < 1) {
+				Usage(argv[0]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--dna") == 0) {
+			options.dna = true;
+		} else if (strcmp(argv[i], "--fasta") == 0) {
+			options.fasta = true;
+		} else if (strncmp(argv[i], "--engine=", 9) == 0) {
+			if (!ParseLcpEngine(argv[i] + 9, options.engine)) {
+				Usage(argv[0]);
+				return 1;
+			}
+		} else if (strncmp(argv[i], "--format=", 9) == 0) {
+			if (!ParseOutputFormat(argv[i] + 9, options.format)) {
+				Usage(argv[0]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--decode") == 0 && i + 1 < argc) {
+			return Decode(argv[i+1], options);
+		} else if (strcmp(argv[i], "--newlines=filter") == 0) {
+			options.newlines = kFilterNewlines;
+		} else if (strcmp(argv[i], "--newlines=separate") == 0) {
+			options.newlines = kSeparateNewlines;
+		} else if (argv[i][0] == '-') {
+			Usage(argv[0]);
+			return 1;
+		} else {
+			directory = argv[i];
+		}
+	}
+	
+	if (bench) {
+		return Benchmark(directory, json, label);
+	}
+	if (serve_path != NULL) {
+		return Serve(serve_path, socket_path, batch.threads);
+	}
+	if (index) {
+		// the index holds plain suffix and LCP arrays, not generalized ones
+		if (batch_path != NULL || external || verify || repeats || options.fasta) {
+			Usage(argv[0]);
+			return 1;
+		}
+		SetConstructionThreads(batch.threads);
+		return RunIndex(directory, options) > 0 ? 1 : 0;
+	}
+	if (repeats) {
+		if (batch_path != NULL || external || verify) {
+			Usage(argv[0]);
+			return 1;
+		}
+		SetConstructionThreads(batch.threads);
+		return RunRepeats(directory, options, query);
+	}
+	if (verify) {
+		// outputs of FASTA/FASTQ inputs stop at record ends, which the
+		// check doesn't know about
+		if (batch_path != NULL || external || options.fasta) {
+			Usage(argv[0]);
+			return 1;
+		}
+		return VerifyOutputs(directory, options) > 0 ? 1 : 0;
+	}
+	if (external) {
+		// the external construction reads plain texts, one file at a time
+		if (batch_path != NULL || options.fasta || options.dna || options.use_mmap) {
+			Usage(argv[0]);
+			return 1;
+		}
+		RunExternal(directory, options, batch.memory_budget);
+		return 0;
+	}
+	if (batch_path != NULL) {
+		return RunBatch(batch_path, options, batch);
+	}
+	SetConstructionThreads(batch.threads);
+	Run(directory, options);
 	return 0;
 }
@@ -0,0 +1,442 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+#include "output.h"
+#include "input.h"
+
+/*
+ * Buffered writer of bytes to a file.
+ */
+class OutputBuffer {
+  public:
+  FILE *file;
+  vector<unsigned char> buffer;
+  size_t used;
+  size_t written;
+  bool failed;
+
+  OutputBuffer(FILE *file_) {
+    file = file_;
+    buffer.resize(1 << 20);
+    used = 0;
+    written = 0;
+    failed = false;
+  }
+
+/*
+ * Writes out the buffered bytes.
+ */
+  void Flush() {
+    if (used > 0 && fwrite(&buffer[0], 1, used, file) != used) {
+      failed = true;
+    }
+    written += used;
+    used = 0;
+  }
+
+/*
+ * Makes sure there is room for at least 'bytes' more bytes.
+ */
+  void Reserve(size_t bytes) {
+    if (used + bytes > buffer.size()) {
+      Flush();
+    }
+  }
+
+  void PutByte(unsigned char byte) {
+    Reserve(1);
+    buffer[used++] = byte;
+  }
+
+/*
+ * Puts the lowest 'bytes' bytes of the value, little-endian.
+ */
+  void PutLittleEndian(unsigned long long value, int bytes) {
+    Reserve(bytes);
+    for (int i = 0; i < bytes; i++) {
+      buffer[used++] = (value >> (8*i)) & 0xff;
+    }
+  }
+
+/*
+ * Puts the value in decimal, followed by a space.
+ */
+  void PutDecimal(long long value) {
+    Reserve(24);
+    char digits[24];
+    int count = 0;
+    unsigned long long magnitude = value < 0 ? -(unsigned long long)value : value;
+    do {
+      digits[count++] = '0' + magnitude % 10;
+      magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) {
+      buffer[used++] = '-';
+    }
+    while (count > 0) {
+      buffer[used++] = digits[--count];
+    }
+    buffer[used++] = ' ';
+  }
+
+/*
+ * Puts the value as a LEB128 varint.
+ */
+  void PutVarint(unsigned long long value) {
+    Reserve(10);
+    while (value >= 0x80) {
+      buffer[used++] = (value & 0x7f) | 0x80;
+      value >>= 7;
+    }
+    buffer[used++] = value;
+  }
+};
+
+/*
+ * Zigzag encoding, maps small negative and positive numbers to small
+ * unsigned numbers.
+ */
+inline unsigned long long Zigzag(long long value) {
+  return ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63);
+}
+
+inline long long Unzigzag(unsigned long long value) {
+  return (long long)(value >> 1) ^ -(long long)(value & 1);
+}
+
+/*
+ * Parses the format name (text, int32, int64, packed, varint), returns
+ * false for unknown names.
+ */
+bool ParseOutputFormat(const char *name, OutputFormat& format) {
+  const char *names[] = {"text", "int32", "int64", "packed", "varint"};
+  const OutputFormat formats[] = {kTextOutput, kInt32Output, kInt64Output, kPackedOutput, kVarintOutput};
+  for (int i = 0; i < 5; i++) {
+    if (strcmp(name, names[i]) == 0) {
+      format = formats[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * Returns the file extension used for the format.
+ */
+const char *OutputExtension(OutputFormat format) {
+  switch (format) {
+    case kInt32Output: return "int32";
+    case kInt64Output: return "int64";
+    case kPackedOutput: return "packed";
+    case kVarintOutput: return "varint";
+    default: return "txt";
+  }
+}
+
+/*
+ * Returns true if the value fits into 32 bits.
+ */
+inline bool FitsInt32(long long value) {
+  return value >= -2147483648LL && value <= 2147483647LL;
+}
+
+/*
+ * Writes the values to the file in the given format. Returns false if the
+ * file can't be written, or if a value doesn't fit into the 32 bits of the
+ * int32 or packed format.
+ */
+template<class Value>
+bool WriteValues(const char *filename, const vector<Value>& values, OutputFormat format) {
+  if (format == kInt32Output || format == kPackedOutput) {
+    for (size_t i = 0; i < values.size(); i++) {
+      if (!FitsInt32(values[i])) {
+        return false;
+      }
+    }
+  }
+
+  FILE *file = fopen(filename, "wb");
+  if (file == NULL) {
+    return false;
+  }
+
+  OutputBuffer out(file);
+  const size_t n = values.size();
+  switch (format) {
+    case kTextOutput:
+      for (size_t i = 0; i < n; i++) {
+        out.PutDecimal(values[i]);
+      }
+      break;
+    case kInt32Output:
+      for (size_t i = 0; i < n; i++) {
+        out.PutLittleEndian((unsigned int)values[i], 4);
+      }
+      break;
+    case kInt64Output:
+      for (size_t i = 0; i < n; i++) {
+        out.PutLittleEndian((long long)values[i], 8);
+      }
+      break;
+    case kPackedOutput:
+      out.PutLittleEndian(n, 8);
+      for (size_t i = 0; i < n; i++) {
+        out.PutByte(values[i] >= 0 && values[i] < 255 ? values[i] : 255);
+      }
+      for (size_t i = 0; i < n; i++) {
+        if (values[i] < 0 || values[i] >= 255) {
+          out.PutLittleEndian((unsigned int)values[i], 4);
+        }
+      }
+      break;
+    case kVarintOutput: {
+      long long previous = 0;
+      for (size_t i = 0; i < n; i++) {
+        out.PutVarint(Zigzag(values[i] - previous));
+        previous = values[i];
+      }
+      break;
+    }
+  }
+
+  out.Flush();
+  bool ok = !out.failed;
+  if (fclose(file) != 0) {
+    ok = false;
+  }
+  return ok;
+}
+
+/*
+ * Reads a little-endian number of 'bytes' bytes.
+ */
+inline unsigned long long GetLittleEndian(const unsigned char *data, int bytes) {
+  unsigned long long value = 0;
+  for (int i = 0; i < bytes; i++) {
+    value |= (unsigned long long)data[i] << (8*i);
+  }
+  return value;
+}
+
+template bool WriteValues<int>(const char *filename, const vector<int>& values, OutputFormat format);
+template bool WriteValues<long long>(const char *filename, const vector<long long>& values, OutputFormat format);
+
+/*
+ * Reads values written by WriteValues in the given format. Returns false if
+ * the file can't be read or is malformed.
+ */
+template<class Value>
+bool ReadValues(const char *filename, vector<Value>& values, OutputFormat format) {
+  MappedFile file;
+  if (!file.Open(filename)) {
+    return false;
+  }
+
+  const unsigned char *data = (const unsigned char *)file.data;
+  const size_t size = file.size;
+  values.clear();
+
+  switch (format) {
+    case kTextOutput: {
+      size_t i = 0;
+      while (i < size) {
+        while (i < size && (data[i] == ' ' || data[i] == '\n')) {
+          i++;
+        }
+        if (i == size) {
+          break;
+        }
+        bool negative = data[i] == '-';
+        if (negative) {
+          i++;
+        }
+        if (i == size || data[i] < '0' || data[i] > '9') {
+          return false;
+        }
+        long long value = 0;
+        while (i < size && data[i] >= '0' && data[i] <= '9') {
+          value = value * 10 + (data[i++] - '0');
+        }
+        values.push_back(negative ? -value : value);
+      }
+      return true;
+    }
+    case kInt32Output:
+    case kInt64Output: {
+      const int bytes = format == kInt32Output ? 4 : 8;
+      if (size % bytes != 0) {
+        return false;
+      }
+      values.resize(size / bytes);
+      for (size_t i = 0; i < values.size(); i++) {
+        unsigned long long value = GetLittleEndian(data + i*bytes, bytes);
+        values[i] = bytes == 4 ? (Value)(int)value : (Value)(long long)value;
+      }
+      return true;
+    }
+    case kPackedOutput: {
+      if (size < 8) {
+        return false;
+      }
+      const size_t n = GetLittleEndian(data, 8);
+      if (n > size - 8) {
+        return false;
+      }
+      const unsigned char *overflow = data + 8 + n;
+      const unsigned char *end = data + size;
+      values.resize(n);
+      for (size_t i = 0; i < n; i++) {
+        unsigned char byte = data[8 + i];
+        if (byte < 255) {
+          values[i] = byte;
+        } else {
+          if (end - overflow < 4) {
+            return false;
+          }
+          values[i] = (int)GetLittleEndian(overflow, 4);
+          overflow += 4;
+        }
+      }
+      return overflow == end;
+    }
+    case kVarintOutput: {
+      long long previous = 0;
+      size_t i = 0;
+      while (i < size) {
+        unsigned long long value = 0;
+        int shift = 0;
+        while (i < size && (data[i] & 0x80) && shift < 63) {
+          value |= (unsigned long long)(data[i++] & 0x7f) << shift;
+          shift += 7;
+        }
+        if (i == size) {
+          return false;
+        }
+        value |= (unsigned long long)data[i++] << shift;
+        previous += Unzigzag(value);
+        values.push_back(previous);
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+template bool ReadValues<int>(const char *filename, vector<int>& values, OutputFormat format);
+template bool ReadValues<long long>(const char *filename, vector<long long>& values, OutputFormat format);
+
+ValueWriter::ValueWriter() {
+  file = NULL;
+  overflow_file = NULL;
+  out = NULL;
+  overflow = NULL;
+  format = kTextOutput;
+  previous = 0;
+  failed = false;
+  bytes = 0;
+}
+
+ValueWriter::~ValueWriter() {
+  Close();
+}
+
+/*
+ * Creates the file, returns false if it can't be created.
+ */
+bool ValueWriter::Open(const char *filename, OutputFormat format_, size_t count) {
+  Close();
+  file = fopen(filename, "wb");
+  if (file == NULL) {
+    return false;
+  }
+  format = format_;
+  previous = 0;
+  failed = false;
+  bytes = 0;
+  out = new OutputBuffer(file);
+  if (format == kPackedOutput) {
+    overflow_file = tmpfile();
+    if (overflow_file == NULL) {
+      failed = true;
+    } else {
+      overflow = new OutputBuffer(overflow_file);
+    }
+    out->PutLittleEndian(count, 8);
+  }
+  return true;
+}
+
+/*
+ * Writes the next value.
+ */
+void ValueWriter::Put(long long value) {
+  if ((format == kInt32Output || format == kPackedOutput) && !FitsInt32(value)) {
+    failed = true;
+  }
+  switch (format) {
+    case kTextOutput:
+      out->PutDecimal(value);
+      break;
+    case kInt32Output:
+      out->PutLittleEndian((unsigned int)value, 4);
+      break;
+    case kInt64Output:
+      out->PutLittleEndian(value, 8);
+      break;
+    case kPackedOutput:
+      out->PutByte(value >= 0 && value < 255 ? value : 255);
+      if ((value < 0 || value >= 255) && overflow != NULL) {
+        overflow->PutLittleEndian((unsigned int)value, 4);
+      }
+      break;
+    case kVarintOutput:
+      out->PutVarint(Zigzag(value - previous));
+      previous = value;
+      break;
+  }
+}
+
+/*
+ * Finishes the file, appending the overflow table of the packed format.
+ * Returns false if anything failed to be written.
+ */
+bool ValueWriter::Close() {
+  if (file == NULL) {
+    return false;
+  }
+  out->Flush();
+  if (overflow != NULL) {
+    overflow->Flush();
+    failed |= overflow->failed;
+    rewind(overflow_file);
+    size_t read;
+    while ((read = fread(&out->buffer[0], 1, out->buffer.size(), overflow_file)) > 0) {
+      out->used = read;
+      out->Flush();
+    }
+  }
+  failed |= out->failed;
+  bytes = out->written;
+  if (fclose(file) != 0) {
+    failed = true;
+  }
+  if (overflow_file != NULL) {
+    fclose(overflow_file);
+  }
+  delete out;
+  delete overflow;
+  file = NULL;
+  overflow_file = NULL;
+  out = NULL;
+  overflow = NULL;
+  return !failed;
+}
+
+/*
+ * Returns the number of bytes written so far.
+ */
+size_t ValueWriter::Bytes() const {
+  return out == NULL ? bytes : out->written + out->used;
+}
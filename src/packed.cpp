@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <cstring>
+using namespace std;
+
+#include "packed.h"
+
+/*
+ * Returns the 2-bit code of a base, or -1 for any other character.
+ */
+inline int BaseCode(char c) {
+  switch (c) {
+    case 'A': return 0;
+    case 'C': return 1;
+    case 'G': return 2;
+    case 'T': return 3;
+    default: return -1;
+  }
+}
+
+/*
+ * Packs the text of the given length. Letters are counted on the way, so
+ * the buckets can be laid out without reading the text again.
+ */
+PackedDna::PackedDna(const char *text, size_t length) {
+  size = length;
+  // one more word, so a window can always read the word after its first
+  words.assign(length / 32 + 2, 0);
+  exception_words.assign(words.size() / 64 + 1, 0);
+  memset(counts, 0, sizeof(counts));
+
+  for (size_t i = 0; i < length; i++) {
+    counts[(unsigned char)text[i]]++;
+    int code = BaseCode(text[i]);
+    if (code < 0) {
+      exception_positions.push_back(i);
+      exception_chars.push_back(text[i]);
+      exception_words[i >> 11] |= 1ULL << ((i >> 5) & 63);
+      code = 0;
+    }
+    words[i >> 5] |= (uint64_t)code << (62 - 2 * (i & 31));
+  }
+}
+
+/*
+ * Returns the length of the common prefix of the suffixes at a and b,
+ * looking at no more than 'length' characters. Runs of plain bases are
+ * compared 32 at a time, by XOR of windows and counting leading zeros,
+ * exceptions one by one.
+ */
+size_t PackedDna::CommonPrefix(size_t a, size_t b, size_t length) const {
+  size_t k = 0;
+  while (k < length) {
+    // plain bases of both suffixes, up to the next exception of either
+    size_t plain = min(NextException(a + k) - (a + k), NextException(b + k) - (b + k));
+    plain = min(plain, length - k);
+
+    size_t end = k + plain;
+    while (k + 32 <= end) {
+      uint64_t diff = Window(a + k) ^ Window(b + k);
+      if (diff != 0) {
+        return k + __builtin_clzll(diff) / 2;
+      }
+      k += 32;
+    }
+    if (k < end) {
+      uint64_t diff = (Window(a + k) ^ Window(b + k)) & ~(~0ULL >> (2 * (end - k)));
+      if (diff != 0) {
+        return k + __builtin_clzll(diff) / 2;
+      }
+      k = end;
+    }
+
+    if (k == length || at(a + k) != at(b + k)) {
+      return k;
+    }
+    k++;
+  }
+  return k;
+}
+
+/*
+ * Returns the number of bytes used by the packed text.
+ */
+size_t PackedDna::Bytes() const {
+  return words.size() * sizeof(uint64_t) + exception_words.size() * sizeof(uint64_t) +
+      exception_positions.size() * (sizeof(size_t) + sizeof(char));
+}
@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+using namespace std;
+
+#include "repeats.h"
+
+/*
+ * An lcp-interval on the stack of the bottom-up traversal: the suffix
+ * array range starting at lb whose suffixes share lcp characters. Left
+ * characters (the ones before every suffix of the interval) are kept as a
+ * set, along with whether the interval has a suffix starting a record (at
+ * position 0, or after a separator of a generalized text), whose left
+ * character differs from all others, whether a left character repeats
+ * among its leaves, and whether it has child intervals.
+ */
+struct LcpInterval {
+  long long lcp;
+  long long lb;
+  uint64_t left[4];
+  bool record_start;
+  bool left_repeats;
+  bool has_child;
+
+  LcpInterval(long long lcp_, long long lb_) : lcp(lcp_), lb(lb_), record_start(false), left_repeats(false),
+      has_child(false) {
+    left[0] = left[1] = left[2] = left[3] = 0;
+  }
+
+/*
+ * Adds the suffix at the text position as a leaf of the interval.
+ */
+  void AddLeaf(const Text& input, long long position, bool generalized) {
+    if (position == 0 || (generalized && input[position - 1] == kSeparator)) {
+      record_start = true;
+      return;
+    }
+    const unsigned char c = input[position - 1];
+    const uint64_t bit = 1ULL << (c & 63);
+    left_repeats = left_repeats || (left[c >> 6] & bit) != 0;
+    left[c >> 6] |= bit;
+  }
+
+/*
+ * Adds a child interval.
+ */
+  void AddChild(const LcpInterval& child) {
+    for (int w = 0; w < 4; w++) {
+      left[w] |= child.left[w];
+    }
+    record_start = record_start || child.record_start;
+    has_child = true;
+  }
+
+/*
+ * Returns true if the suffixes don't all have the same left character, so
+ * the common prefix can't be extended to the left.
+ */
+  bool LeftMaximal() const {
+    int characters = 0;
+    for (int w = 0; w < 4; w++) {
+      characters += __builtin_popcountll(left[w]);
+    }
+    return record_start || characters > 1;
+  }
+};
+
+/*
+ * Reports the popped interval [lb, rb]: it is the longest repeat so far,
+ * a maximal repeat if it is left maximal (every lcp-interval is right
+ * maximal), and a supermaximal one if, on top of that, it has no child
+ * intervals and distinct left characters.
+ */
+template<class Value>
+void ReportInterval(const LcpInterval& interval, long long rb, const Value* sa, const RepeatQuery& query,
+    RepeatAnalysis& analysis) {
+  const Repeat repeat(sa[interval.lb], interval.lcp, rb - interval.lb + 1);
+  if (repeat.length > analysis.longest.length) {
+    analysis.longest = repeat;
+  }
+  if (repeat.length < query.min_length || !interval.LeftMaximal()) {
+    return;
+  }
+  analysis.maximal_count++;
+  if (query.keep_maximal) {
+    analysis.maximal.push_back(repeat);
+  }
+  if (!interval.has_child && !interval.left_repeats) {
+    analysis.supermaximal_count++;
+    if (query.keep_supermaximal) {
+      analysis.supermaximal.push_back(repeat);
+    }
+  }
+}
+
+/*
+ * Marks the text positions starting a k-mer that runs into neither a
+ * separator nor the sentinel.
+ */
+void KmerStarts(const Text& input, long long k, vector<bool>& starts) {
+  const long long n = input.length();
+  starts.assign(n, false);
+  long long run = 0;
+  for (long long j = n - 1; j >= 0; j--) {
+    const char c = input[j];
+    run = c == kSentinel || c == kSeparator ? 0 : run + 1;
+    starts[j] = run >= k;
+  }
+}
+
+/*
+ * The bottom-up traversal of Abouelhoda, Kurtz and Ohlebusch: lcp-intervals
+ * are pushed where the LCP value grows, and popped, with their right
+ * bound, where it falls, as children of the interval below them or of a
+ * new one. Suffix i - 1 is a leaf of the deepest interval open at i. The
+ * k-mer groups (runs with LCP values of at least k) are closed in the same
+ * pass.
+ */
+template<class Value>
+void Analyze(const Text& input, const Value* sa, const Value* lcp, const RepeatQuery& query,
+    RepeatAnalysis& analysis) {
+  analysis = RepeatAnalysis();
+  const long long n = input.length();
+  if (n == 0) {
+    return;
+  }
+  const long long k = query.kmer_length;
+  vector<bool> kmer_starts;
+  if (k > 0) {
+    KmerStarts(input, k, kmer_starts);
+  }
+
+  vector<LcpInterval> stack;
+  stack.push_back(LcpInterval(0, 0));
+  long long group = 0;
+  for (long long i = 1; i <= n; i++) {
+    const long long current = i < n ? (long long)lcp[i] : 0;
+
+    if (k > 0 && (i == n || current < k)) {
+      if (kmer_starts[sa[group]]) {
+        analysis.spectrum[i - group]++;
+      }
+      group = i;
+    }
+
+    if (current > stack.back().lcp) {
+      stack.push_back(LcpInterval(current, i - 1));
+      stack.back().AddLeaf(input, sa[i-1], query.generalized);
+      continue;
+    }
+    stack.back().AddLeaf(input, sa[i-1], query.generalized);
+    while (current < stack.back().lcp) {
+      LcpInterval interval = stack.back();
+      stack.pop_back();
+      ReportInterval(interval, i - 1, sa, query, analysis);
+      if (current <= stack.back().lcp) {
+        stack.back().AddChild(interval);
+      } else {
+        stack.push_back(LcpInterval(current, interval.lb));
+        stack.back().AddChild(interval);
+      }
+    }
+  }
+}
+
+void AnalyzeRepeats(const Text& input, const int* sa, const int* lcp, const RepeatQuery& query,
+    RepeatAnalysis& analysis) {
+  Analyze(input, sa, lcp, query, analysis);
+}
+
+void AnalyzeRepeats(const Text& input, const long long* sa, const long long* lcp, const RepeatQuery& query,
+    RepeatAnalysis& analysis) {
+  Analyze(input, sa, lcp, query, analysis);
+}
+
+/*
+ * IndexAndAnalyzeRepeats with Value as the type of the arrays.
+ */
+template<class Value>
+void IndexAndAnalyzeAs(const Text& input, LcpEngine engine, const RepeatQuery& query, RepeatAnalysis& analysis) {
+  const size_t n = input.length();
+  vector<Value> sa(n), lcp(n);
+  if (query.generalized) {
+    vector<Value> documents(n);
+    CalculateGeneralizedSuffixArrayLCP(input, &sa[0], &lcp[0], &documents[0]);
+  } else {
+    CalculateSuffixArrayLCP(input, &sa[0], &lcp[0], engine);
+  }
+  Analyze(input, &sa[0], &lcp[0], query, analysis);
+}
+
+void IndexAndAnalyzeRepeats(const Text& input, LcpEngine engine, const RepeatQuery& query, RepeatAnalysis& analysis) {
+  if (input.length() == 0) {
+    analysis = RepeatAnalysis();
+    return;
+  }
+  if ((long long)input.length() <= kMaxInt32Length) {
+    IndexAndAnalyzeAs<int>(input, engine, query, analysis);
+  } else {
+    IndexAndAnalyzeAs<long long>(input, engine, query, analysis);
+  }
+}
+
+void WriteRepeats(FILE *file, const vector<Repeat>& repeats) {
+  for (size_t i = 0; i < repeats.size(); i++) {
+    fprintf(file, "%lld %lld %lld\n", repeats[i].length, repeats[i].count, repeats[i].position);
+  }
+}
+
+void WriteSpectrum(FILE *file, const map<long long, long long>& spectrum) {
+  for (map<long long, long long>::const_iterator it = spectrum.begin(); it != spectrum.end(); ++it) {
+    fprintf(file, "%lld %lld\n", it->first, it->second);
+  }
+}
@@ -0,0 +1,188 @@
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+#include "sais.h"
+
+/*
+ * Calculates bucket borders for every symbol of the alphabet, the first
+ * slot of each bucket, or one past its last slot if 'ends' is set.
+ */
+template<class Index>
+void BucketBorders(const vector<Index>& s, Index alphabet, vector<Index>& borders, bool ends) {
+  borders.assign(alphabet, 0);
+  for (Index i = 0; i < (Index)s.size(); i++) {
+    borders[s[i]]++;
+  }
+
+  Index sum = 0;
+  for (Index c = 0; c < alphabet; c++) {
+    Index count = borders[c];
+    borders[c] = ends ? sum + count : sum;
+    sum += count;
+  }
+}
+
+/*
+ * Returns true if there is an LMS (leftmost S) suffix at index i.
+ */
+template<class Index>
+inline bool IsLms(const vector<bool>& stype, Index i) {
+  return i > 0 && stype[i] && !stype[i-1];
+}
+
+/*
+ * Places the LMS suffixes at the ends of their buckets, in the given order,
+ * and induces the order of L and then S suffixes from them.
+ */
+template<class Index>
+void InducedSort(const vector<Index>& s, Index alphabet, const vector<bool>& stype, const vector<Index>& lms, vector<Index>& sa,
+    vector<Index>& borders) {
+  const Index n = s.size();
+  fill(sa.begin(), sa.end(), -1);
+
+  BucketBorders(s, alphabet, borders, true);
+  for (Index i = (Index)lms.size()-1; i >= 0; i--) {
+    sa[--borders[s[lms[i]]]] = lms[i];
+  }
+
+  // the virtual sentinel is the smallest suffix, and the last suffix,
+  // which is always L, is induced from it
+  BucketBorders(s, alphabet, borders, false);
+  sa[borders[s[n-1]]++] = n-1;
+  for (Index i = 0; i < n; i++) {
+    Index j = sa[i] - 1;
+    if (j >= 0 && !stype[j]) {
+      sa[borders[s[j]]++] = j;
+    }
+  }
+
+  BucketBorders(s, alphabet, borders, true);
+  for (Index i = n-1; i >= 0; i--) {
+    Index j = sa[i] - 1;
+    if (j >= 0 && stype[j]) {
+      sa[--borders[s[j]]] = j;
+    }
+  }
+}
+
+/*
+ * Returns true if LMS substrings starting at a and b are equal. Both
+ * substrings end at the next LMS suffix, next_a and next_b respectively.
+ */
+template<class Index>
+bool EqualLmsSubstrings(const vector<Index>& s, Index a, Index next_a, Index b, Index next_b) {
+  const Index n = s.size();
+  if (next_a - a != next_b - b || next_a == n || next_b == n) {
+    return false;
+  }
+  for (Index k = 0; k <= next_a - a; k++) {
+    if (s[a+k] != s[b+k]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Builds the suffix array of the string s over the integer alphabet
+ * [0, alphabet) with the SA-IS algorithm. The end of the string acts as
+ * a virtual sentinel, smaller than every symbol.
+ */
+template<class Index>
+void SuffixArray(const vector<Index>& s, Index alphabet, vector<Index>& sa) {
+  SaisWorkspace<Index> workspace;
+  SuffixArray(s, alphabet, sa, workspace);
+}
+
+/*
+ * Same, with the scratch buffers of the workspace, starting at the given
+ * recursion level.
+ */
+template<class Index>
+void SuffixArray(const vector<Index>& s, Index alphabet, vector<Index>& sa, SaisWorkspace<Index>& workspace,
+    size_t level) {
+  const Index n = s.size();
+  sa.assign(n, -1);
+  if (n <= 1) {
+    if (n == 1) {
+      sa[0] = 0;
+    }
+    return;
+  }
+  if (workspace.levels.size() <= level) {
+    workspace.levels.resize(level + 1);
+  }
+  SaisLevel<Index>& scratch = workspace.levels[level];
+
+  vector<bool>& stype = scratch.stype;
+  stype.assign(n, false);
+  for (Index i = n-2; i >= 0; i--) {
+    stype[i] = s[i] < s[i+1] || (s[i] == s[i+1] && stype[i+1]);
+  }
+
+  vector<Index>& lms = scratch.lms;
+  lms.clear();
+  for (Index i = 1; i < n; i++) {
+    if (IsLms(stype, i)) {
+      lms.push_back(i);
+    }
+  }
+  const Index m = lms.size();
+
+  InducedSort(s, alphabet, stype, lms, sa, scratch.borders);
+  if (m == 0) {
+    return;
+  }
+
+  // LMS suffixes are at least two apart, so i/2 identifies them
+  vector<Index>& ordinal = scratch.ordinal;
+  ordinal.assign(n/2 + 1, -1);
+  for (Index k = 0; k < m; k++) {
+    ordinal[lms[k]/2] = k;
+  }
+
+  // names the LMS substrings, in their induced order
+  vector<Index>& reduced = scratch.reduced;
+  reduced.resize(m);
+  Index name = -1;
+  Index prev = -1, prev_next = -1;
+  for (Index i = 0; i < n; i++) {
+    Index j = sa[i];
+    if (!IsLms(stype, j)) {
+      continue;
+    }
+    Index k = ordinal[j/2];
+    Index next = k + 1 < m ? lms[k+1] : n;
+    if (prev == -1 || !EqualLmsSubstrings(s, prev, prev_next, j, next)) {
+      name++;
+    }
+    reduced[k] = name;
+    prev = j;
+    prev_next = next;
+  }
+
+  vector<Index>& reduced_sa = scratch.reduced_sa;
+  if (name + 1 < m) {
+    SuffixArray(reduced, name + 1, reduced_sa, workspace, level + 1);
+  } else {
+    reduced_sa.resize(m);
+    for (Index k = 0; k < m; k++) {
+      reduced_sa[reduced[k]] = k;
+    }
+  }
+
+  vector<Index>& sorted_lms = scratch.sorted_lms;
+  sorted_lms.resize(m);
+  for (Index k = 0; k < m; k++) {
+    sorted_lms[k] = lms[reduced_sa[k]];
+  }
+  InducedSort(s, alphabet, stype, sorted_lms, sa, scratch.borders);
+}
+
+template void SuffixArray<int>(const vector<int>& s, int alphabet, vector<int>& sa);
+template void SuffixArray<long long>(const vector<long long>& s, long long alphabet, vector<long long>& sa);
+template void SuffixArray<int>(const vector<int>& s, int alphabet, vector<int>& sa, SaisWorkspace<int>& workspace,
+    size_t level);
+template void SuffixArray<long long>(const vector<long long>& s, long long alphabet, vector<long long>& sa,
+    SaisWorkspace<long long>& workspace, size_t level);
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "search.h"
+#include "compare.h"
+#include "parallel.h"
+
+/*
+ * Weight of a query apart from its pattern length, for splitting batches.
+ */
+const long long kQueryWeight = 32;
+
+/*
+ * Returns the first suffix array slot in [lo, hi) whose suffix is not
+ * smaller than the pattern (upper false), or that doesn't start with the
+ * pattern and is larger (upper true). Suffixes before lo share l
+ * characters with the pattern, the one at hi shares r, and the comparison
+ * of every probe starts after min(l, r) of them (mlr). Characters compare
+ * as signed chars, like in the construction, and the sentinel at the end
+ * of the text matches none and is smaller than all.
+ */
+template<class Value>
+uint64_t Bound(const Text& text, const Value* sa, uint64_t lo, uint64_t hi, size_t l, size_t r,
+    const char *pattern, size_t length, bool upper) {
+  const size_t sentinel = text.length() - 1;
+  while (lo < hi) {
+    const uint64_t mid = lo + (hi - lo) / 2;
+    const size_t suffix = sa[mid];
+    size_t k = min(l, r);
+    k += CommonPrefix(text.data + suffix + k, pattern + k, min(length - k, sentinel - suffix - k));
+
+    bool right;
+    if (k == length) {
+      right = upper;
+    } else if (suffix + k == sentinel) {
+      right = true;
+    } else {
+      right = (signed char)text.data[suffix + k] < (signed char)pattern[k];
+    }
+    if (right) {
+      lo = mid + 1;
+      l = k;
+    } else {
+      hi = mid;
+      r = k;
+    }
+  }
+  return lo;
+}
+
+/*
+ * FindPattern with Value as the type of the suffix array.
+ */
+template<class Value>
+SuffixRange FindIn(const LcpIndex& index, const Value* sa, const char *pattern, size_t length) {
+  SuffixRange range;
+  range.begin = 0;
+  range.end = index.length();
+  if (length == 0) {
+    return range;
+  }
+  const Text text = index.text();
+  range.begin = index.BucketBegin(pattern[0]);
+  range.end = index.BucketEnd(pattern[0]);
+  if (range.begin == range.end || length == 1) {
+    return range;
+  }
+  // every suffix of the bucket shares the first character with the pattern
+  range.begin = Bound(text, sa, range.begin, range.end, 1, 1, pattern, length, false);
+  range.end = Bound(text, sa, range.begin, range.end, 1, 1, pattern, length, true);
+  return range;
+}
+
+SuffixRange FindPattern(const LcpIndex& index, const char *pattern, size_t length) {
+  if (index.header.index_bytes == 4) {
+    return FindIn(index, index.sa32(), pattern, length);
+  }
+  return FindIn(index, index.sa64(), pattern, length);
+}
+
+/*
+ * Returns the next whitespace-separated field of the line from pos on, and
+ * moves pos past it; an empty string if there is none.
+ */
+string NextField(const string& line, size_t& pos) {
+  while (pos < line.length() && isspace((unsigned char)line[pos])) {
+    pos++;
+  }
+  const size_t begin = pos;
+  while (pos < line.length() && !isspace((unsigned char)line[pos])) {
+    pos++;
+  }
+  return line.substr(begin, pos - begin);
+}
+
+bool ParseQuery(const string& line, Query& query, string& error) {
+  size_t pos = 0;
+  const string name = NextField(line, pos);
+  const string pattern = NextField(line, pos);
+  const string limit = NextField(line, pos);
+  const bool more = !NextField(line, pos).empty();
+  query.limit = kDefaultLocateLimit;
+  if (name == "stats" && pattern.empty()) {
+    query.kind = kStatsQuery;
+    return true;
+  }
+  
+  bool valid = !pattern.empty() && !more;
+  if (name == "count" && limit.empty()) {
+    query.kind = kCountQuery;
+  } else if (name == "locate") {
+    query.kind = kLocateQuery;
+    if (!limit.empty()) {
+      char *end;
+      query.limit = strtoll(limit.c_str(), &end, 10);
+      valid = valid && *end == 0 && query.limit >= 0;
+    }
+  } else {
+    valid = false;
+  }
+  if (!valid) {
+    error = "expected count PATTERN, locate PATTERN [LIMIT] or stats";
+    return false;
+  }
+  query.pattern = pattern;
+  return true;
+}
+
+/*
+ * Answers one count or locate query.
+ */
+string Answer(const LcpIndex& index, const Query& query) {
+  const SuffixRange range = FindPattern(index, query.pattern.data(), query.pattern.length());
+  string answer = to_string((unsigned long long)(range.end - range.begin));
+  if (query.kind == kLocateQuery) {
+    const uint64_t end = min(range.end, range.begin + (uint64_t)query.limit);
+    for (uint64_t i = range.begin; i < end; i++) {
+      answer += ' ';
+      answer += to_string(index.Sa(i));
+    }
+  }
+  return answer;
+}
+
+void AnswerQueries(const LcpIndex& index, const vector<Query>& queries, int threads, vector<string>& answers) {
+  answers.resize(queries.size());
+  vector<long long> weight_prefix(queries.size() + 1, 0);
+  for (size_t i = 0; i < queries.size(); i++) {
+    weight_prefix[i + 1] = weight_prefix[i] + queries[i].pattern.length() + kQueryWeight;
+  }
+  ParallelRanges(weight_prefix, threads, [&index, &queries, &answers](long long begin, long long end) {
+    for (long long i = begin; i < end; i++) {
+      answers[i] = Answer(index, queries[i]);
+    }
+  });
+}
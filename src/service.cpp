@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+using namespace std;
+
+#include "service.h"
+#include "timer.h"
+
+/*
+ * Bytes read at once, and most lines answered in one batch.
+ */
+const size_t kReadBytes = 1 << 16;
+const size_t kMaxBatch = 1 << 16;
+
+ServiceStats::ServiceStats() {
+  queries = batches = answer_ns = 0;
+  start_ns = Nanoseconds();
+}
+
+void ServiceStats::Add(long long batch_queries, long long ns) {
+  lock_guard<std::mutex> lock(mutex);
+  queries += batch_queries;
+  batches++;
+  answer_ns += ns;
+}
+
+string ServiceStats::Summary() {
+  lock_guard<std::mutex> lock(mutex);
+  const long long wall_ns = max(1LL, Nanoseconds() - start_ns);
+  char summary[256];
+  snprintf(summary, sizeof(summary), "%lld queries in %lld batches, %.0f queries/s answering, "
+      "%.0f queries/s since the start", queries, batches, answer_ns > 0 ? queries * 1e9 / answer_ns : 0.0,
+      queries * 1e9 / wall_ns);
+  return summary;
+}
+
+/*
+ * Writes all bytes, returns false on failure.
+ */
+bool WriteAll(int fd, const string& bytes) {
+  size_t written = 0;
+  while (written < bytes.size()) {
+    ssize_t count = write(fd, bytes.data() + written, bytes.size() - written);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      return false;
+    }
+    written += count;
+  }
+  return true;
+}
+
+/*
+ * Reads from the file descriptor into the buffer: waits for data once,
+ * then takes whatever else is already there, up to the batch limit.
+ * Returns false at the end of the input.
+ */
+bool ReadAvailable(int fd, string& buffer) {
+  char chunk[kReadBytes];
+  size_t lines = 0;
+  bool waited = false;
+  while (lines < kMaxBatch) {
+    if (waited) {
+      struct pollfd ready = {fd, POLLIN, 0};
+      if (poll(&ready, 1, 0) <= 0) {
+        return true;
+      }
+    }
+    ssize_t count = read(fd, chunk, sizeof(chunk));
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      return waited;
+    }
+    buffer.append(chunk, count);
+    lines += count_if(chunk, chunk + count, [](char c) { return c == '\n'; });
+    waited = true;
+  }
+  return true;
+}
+
+/*
+ * Answers the complete lines of the buffer as one batch, and removes them
+ * from it. At the end of the input, the last line needs no newline.
+ */
+string AnswerLines(const LcpIndex& index, string& buffer, bool at_end, int threads, ServiceStats& stats) {
+  vector<string> lines;
+  size_t start = 0;
+  while (true) {
+    size_t newline = buffer.find('\n', start);
+    if (newline == string::npos) {
+      if (at_end && start < buffer.size()) {
+        lines.push_back(buffer.substr(start));
+        start = buffer.size();
+      }
+      break;
+    }
+    lines.push_back(buffer.substr(start, newline - start));
+    start = newline + 1;
+  }
+  buffer.erase(0, start);
+
+  // count and locate queries go to the threads, the rest is answered here
+  vector<Query> queries;
+  vector<string> errors(lines.size());
+  vector<QueryKind> kinds(lines.size(), kStatsQuery);
+  for (size_t i = 0; i < lines.size(); i++) {
+    Query query;
+    if (!ParseQuery(lines[i], query, errors[i])) {
+      errors[i] = "error: " + errors[i];
+      continue;
+    }
+    kinds[i] = query.kind;
+    if (query.kind != kStatsQuery) {
+      queries.push_back(query);
+    }
+  }
+  vector<string> found;
+  if (!queries.empty()) {
+    long long clock = Nanoseconds();
+    AnswerQueries(index, queries, threads, found);
+    stats.Add(queries.size(), Nanoseconds() - clock);
+  }
+
+  string output;
+  for (size_t i = 0, q = 0; i < lines.size(); i++) {
+    if (!errors[i].empty()) {
+      output += errors[i];
+    } else if (kinds[i] == kStatsQuery) {
+      output += stats.Summary();
+    } else {
+      output += found[q++];
+    }
+    output += '\n';
+  }
+  return output;
+}
+
+bool ServeStream(const LcpIndex& index, int in, int out, int threads, ServiceStats& stats) {
+  string buffer;
+  while (true) {
+    const bool more = ReadAvailable(in, buffer);
+    if (!WriteAll(out, AnswerLines(index, buffer, !more, threads, stats))) {
+      return false;
+    }
+    if (!more) {
+      return true;
+    }
+  }
+}
+
+bool ServeSocket(const LcpIndex& index, const char *path, int threads, ServiceStats& stats, string& error) {
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    error = string("socket path too long: ") + path;
+    return false;
+  }
+  strcpy(address.sun_path, path);
+
+  // only a socket left by an earlier run is replaced, never another file
+  struct stat existing;
+  if (lstat(path, &existing) == 0) {
+    if (!S_ISSOCK(existing.st_mode)) {
+      error = string("not a socket, not replacing it: ") + path;
+      return false;
+    }
+    unlink(path);
+  }
+
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0 || ::bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+      listen(listener, 64) != 0) {
+    error = string("could not listen on ") + path + ": " + strerror(errno);
+    if (listener >= 0) {
+      close(listener);
+    }
+    return false;
+  }
+  // a client closing its connection early must not stop the service
+  signal(SIGPIPE, SIG_IGN);
+
+  while (true) {
+    int connection = accept(listener, NULL, NULL);
+    if (connection < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      error = string("accept failed: ") + strerror(errno);
+      close(listener);
+      return false;
+    }
+    thread([&index, connection, threads, &stats]() {
+      ServeStream(index, connection, connection, threads, stats);
+      close(connection);
+      fprintf(stderr, "Connection closed, %s\n", stats.Summary().c_str());
+    }).detach();
+  }
+}
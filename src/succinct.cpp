@@ -0,0 +1,92 @@
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+using namespace std;
+
+#include "succinct.h"
+
+/*
+ * Bits per rank block (8 words), and set bits per select sample.
+ */
+const size_t kBlockBits = 512;
+const size_t kSampleOnes = 512;
+
+/*
+ * Returns the position of the r-th set bit of the word, counting from 0.
+ * The word has more than r set bits.
+ */
+inline int SelectInWord(uint64_t word, int r) {
+#if defined(__BMI2__)
+  return __builtin_ctzll(_pdep_u64(1ULL << r, word));
+#else
+  for (int i = 0; i < r; i++) {
+    word &= word - 1;
+  }
+  return __builtin_ctzll(word);
+#endif
+}
+
+/*
+ * Converts the dense suffix array and LCP array of n elements. Bits are
+ * set in suffix array order; the rank blocks and select samples are then
+ * laid out in one pass over the bitvector.
+ */
+template<class Output>
+SuccinctLcp::SuccinctLcp(const Output* sa, const Output* lcp, size_t n) {
+  size = n;
+  const size_t length = 2 * n + 1;
+  bits.assign((length + kBlockBits - 1) / kBlockBits * (kBlockBits / 64), 0);
+  for (size_t i = 0; i < n; i++) {
+    const size_t bit = (size_t)lcp[i] + 2 * (size_t)sa[i];
+    bits[bit >> 6] |= 1ULL << (bit & 63);
+  }
+
+  const size_t blocks = bits.size() / (kBlockBits / 64);
+  block_ranks.resize(blocks + 1);
+  uint64_t ones = 0;
+  for (size_t b = 0; b < blocks; b++) {
+    block_ranks[b] = ones;
+    uint64_t block_ones = 0;
+    for (size_t w = b * (kBlockBits / 64); w < (b + 1) * (kBlockBits / 64); w++) {
+      block_ones += __builtin_popcountll(bits[w]);
+    }
+    // every sampled one that falls into this block
+    while (select_samples.size() * kSampleOnes < ones + block_ones) {
+      select_samples.push_back(b);
+    }
+    ones += block_ones;
+  }
+  block_ranks[blocks] = ones;
+}
+
+template SuccinctLcp::SuccinctLcp(const int* sa, const int* lcp, size_t n);
+template SuccinctLcp::SuccinctLcp(const long long* sa, const long long* lcp, size_t n);
+
+/*
+ * Returns the position of the k-th set bit, counting from 0. The sample
+ * gives the block of the last sampled one before it, blocks are skipped by
+ * their ranks, and words by their popcounts.
+ */
+size_t SuccinctLcp::Select(size_t k) const {
+  size_t block = select_samples[k / kSampleOnes];
+  while (block_ranks[block + 1] <= k) {
+    block++;
+  }
+  size_t rest = k - block_ranks[block];
+  size_t word = block * (kBlockBits / 64);
+  while (true) {
+    const size_t ones = __builtin_popcountll(bits[word]);
+    if (rest < ones) {
+      return word * 64 + SelectInWord(bits[word], rest);
+    }
+    rest -= ones;
+    word++;
+  }
+}
+
+/*
+ * Returns the number of bytes used.
+ */
+size_t SuccinctLcp::Bytes() const {
+  return (bits.size() + block_ranks.size() + select_samples.size()) * sizeof(uint64_t);
+}
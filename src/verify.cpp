@@ -0,0 +1,182 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "verify.h"
+#include "sais.h"
+
+/*
+ * Marks text positions not seen in the suffix array yet.
+ */
+const long long kUnseen = -2;
+
+/*
+ * Returns "<what>[i] = <value>" for error messages.
+ */
+string Slot(const char *what, long long i, long long value) {
+  char buffer[128];
+  snprintf(buffer, sizeof(buffer), "%s[%lld] = %lld", what, i, value);
+  return buffer;
+}
+
+/*
+ * Returns true if suffix a is smaller than suffix b, given the ranks of all
+ * suffixes: the sentinel at the end is the smallest suffix, otherwise the
+ * first characters decide, signed like in the construction, and equal ones
+ * leave it to the suffixes after them.
+ */
+template<class Value>
+bool SuffixBefore(const Text& input, const vector<Value>& rank, Value a, Value b) {
+  const Value n = input.length();
+  if (a == n - 1) {
+    return true;
+  }
+  if (b == n - 1) {
+    return false;
+  }
+  if ((signed char)input[a] != (signed char)input[b]) {
+    return (signed char)input[a] < (signed char)input[b];
+  }
+  return rank[a + 1] < rank[b + 1];
+}
+
+/*
+ * Checks the arrays with Value as the type of the rank array. Ranks find
+ * repeated and missing positions, and the suffix array is sorted if and
+ * only if every neighbouring pair is in order by its first characters and
+ * the ranks of the suffixes after them (Burkhardt and Karkkainen). Only
+ * then does the Phi algorithm apply: it carries the common prefix from one
+ * text position to the next, which overstates it on an unsorted suffix
+ * array. The ranks are overwritten with the permuted LCP array, in text
+ * order, so the check takes n values of extra memory.
+ */
+template<class Value>
+bool Verify(const Text& input, const Value* sa, const Value* lcp, string& error) {
+  const Value n = input.length();
+  vector<Value> rank(n, kUnseen);
+  for (Value i = 0; i < n; i++) {
+    if (sa[i] < 0 || sa[i] >= n) {
+      error = Slot("sa", i, sa[i]) + " is out of range";
+      return false;
+    }
+    if (rank[sa[i]] != kUnseen) {
+      error = Slot("sa", i, sa[i]) + " is repeated";
+      return false;
+    }
+    rank[sa[i]] = i;
+  }
+
+  for (Value i = 1; i < n; i++) {
+    if (!SuffixBefore(input, rank, sa[i-1], sa[i])) {
+      error = Slot("sa", i - 1, sa[i-1]) + " and " + Slot("sa", i, sa[i]) + " are out of order";
+      return false;
+    }
+  }
+
+  vector<Value>& plcp = rank;
+  Value h = 0;
+  for (Value i = 0; i < n; i++) {
+    if (rank[i] == 0) {
+      plcp[i] = 0;
+      h = 0;
+      continue;
+    }
+    h += Lcp(i + h, sa[rank[i] - 1] + h, input);
+    plcp[i] = h;
+    if (h > 0) {
+      h--;
+    }
+  }
+
+  for (Value i = 0; i < n; i++) {
+    if (lcp[i] != plcp[sa[i]]) {
+      error = Slot("lcp", i, lcp[i]) + ", expected " + to_string((long long)plcp[sa[i]]);
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Builds the suffix array with plain SA-IS, over the characters shifted to
+ * keep their signed order after the sentinel, and checks it with the LCP
+ * array.
+ */
+template<class Value>
+bool VerifyWithSuffixArray(const Text& input, const Value* lcp, string& error) {
+  const Value n = input.length();
+  vector<Value> s(n);
+  for (Value i = 0; i < n - 1; i++) {
+    s[i] = (signed char)input[i] + 129;
+  }
+  vector<Value> sa(n);
+  if (n > 0) {
+    s[n-1] = 0;
+    SuffixArray(s, (Value)257, sa);
+  }
+  return Verify(input, &sa[0], lcp, error);
+}
+
+bool VerifySuffixArrayLCP(const Text& input, const int* sa, const int* lcp, string& error) {
+  return Verify(input, sa, lcp, error);
+}
+
+bool VerifySuffixArrayLCP(const Text& input, const long long* sa, const long long* lcp, string& error) {
+  return Verify(input, sa, lcp, error);
+}
+
+bool VerifyLCP(const Text& input, const int* lcp, string& error) {
+  return VerifyWithSuffixArray(input, lcp, error);
+}
+
+bool VerifyLCP(const Text& input, const long long* lcp, string& error) {
+  return VerifyWithSuffixArray(input, lcp, error);
+}
+
+/*
+ * VerifyFiles with Value as the type of the values read.
+ */
+template<class Value>
+bool VerifyFilesAs(const Text& input, const string& sa_filename, const string& lcp_filename, OutputFormat format,
+    string& error) {
+  const size_t n = input.length();
+  vector<Value> lcp, sa;
+  if (!ReadValues(lcp_filename.c_str(), lcp, format)) {
+    error = "could not read " + lcp_filename;
+    return false;
+  }
+  if (!sa_filename.empty() && !ReadValues(sa_filename.c_str(), sa, format)) {
+    error = "could not read " + sa_filename;
+    return false;
+  }
+  if (lcp.size() != n || (!sa_filename.empty() && sa.size() != n)) {
+    error = "expected " + to_string((unsigned long long)n) + " values, " + lcp_filename + " has " +
+        to_string((unsigned long long)lcp.size());
+    if (!sa_filename.empty()) {
+      error += " and " + sa_filename + " " + to_string((unsigned long long)sa.size());
+    }
+    return false;
+  }
+  if (n == 0) {
+    return true;
+  }
+  if (sa_filename.empty()) {
+    return VerifyWithSuffixArray(input, &lcp[0], error);
+  }
+  return Verify(input, &sa[0], &lcp[0], error);
+}
+
+/*
+ * Reads the LCP array, and the suffix array unless sa_filename is empty,
+ * from files in the given format and checks them against the input.
+ * Values are read as 32-bit if the input is short enough, and 64-bit
+ * otherwise.
+ */
+bool VerifyFiles(const Text& input, const string& sa_filename, const string& lcp_filename, OutputFormat format,
+    string& error) {
+  if ((long long)input.length() <= kMaxInt32Length) {
+    return VerifyFilesAs<int>(input, sa_filename, lcp_filename, format, error);
+  }
+  return VerifyFilesAs<long long>(input, sa_filename, lcp_filename, format, error);
+}